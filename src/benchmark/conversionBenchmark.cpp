@@ -0,0 +1,188 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// compares the previous per-element conversions between maya arrays and prt buffers with the bulk conversions
+// usage: serlio_conversion_benchmark [number of vertices, default 1M] [number of output indices, default 10M]
+//                                    [repetitions, default 10]
+// note: the maya libraries must be found at runtime, e.g. via LD_LIBRARY_PATH=<maya>/lib
+
+#include "utils/Utilities.h"
+
+#include "maya/MFloatArray.h"
+#include "maya/MFloatPointArray.h"
+#include "maya/MIntArray.h"
+#include "maya/MVectorArray.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// f returns a value which is checked against the expected result to make sure the work is not optimized away
+template <typename F>
+void measure(const char* label, size_t expected, size_t repetitions, F f) {
+	std::chrono::duration<double, std::milli> total{0}, best{std::numeric_limits<double>::max()};
+	for (size_t r = 0; r < repetitions; r++) {
+		const auto start = std::chrono::steady_clock::now();
+		const size_t result = f();
+		const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+		total += duration;
+		best = std::min(best, duration);
+		if (result != expected)
+			std::cerr << label << ": unexpected result " << result << std::endl;
+	}
+
+	std::cout << label << ": best " << best.count() << "ms, mean " << total.count() / repetitions << "ms"
+	          << std::endl;
+}
+
+// PRTMesh: maya vertex coordinates to the double coordinates passed to prt
+void measureVertexCoordinates(size_t numVertices, size_t repetitions) {
+	std::vector<float> rawPoints(3 * numVertices); // layout of MFnMesh::getRawPoints
+	std::iota(rawPoints.begin(), rawPoints.end(), 0.0f);
+
+	MFloatPointArray vertexArray(static_cast<unsigned int>(numVertices)); // result of MFnMesh::getPoints
+	for (unsigned int i = 0; i < vertexArray.length(); i++)
+		vertexArray.set(i, rawPoints[3 * i + 0], rawPoints[3 * i + 1], rawPoints[3 * i + 2]);
+
+	std::cout << "vertex coordinates, " << numVertices << " vertices:" << std::endl;
+
+	measure("  push_back per coordinate", rawPoints.size(), repetitions, [&vertexArray]() {
+		std::vector<double> coords;
+		const unsigned int vertexArrayLength = vertexArray.length();
+		coords.reserve(3 * vertexArrayLength);
+		for (unsigned int i = 0; i < vertexArrayLength; ++i) {
+			coords.push_back(vertexArray[i].x);
+			coords.push_back(vertexArray[i].y);
+			coords.push_back(vertexArray[i].z);
+		}
+		return coords.size();
+	});
+
+	measure("  widen", rawPoints.size(), repetitions, [&rawPoints]() {
+		std::vector<double> coords(rawPoints.size());
+		prtu::widen(rawPoints.data(), coords.data(), rawPoints.size());
+		return coords.size();
+	});
+}
+
+// MayaCallbacks::addMesh: double encoder output of a quad mesh to the maya arrays passed to MFnMesh
+void measureMeshOutput(size_t numIndices, size_t repetitions) {
+	const size_t numVertices = numIndices / 4;
+	std::vector<uint32_t> indices(numIndices);
+	std::iota(indices.begin(), indices.end(), 0u);
+	std::vector<double> coords(3 * numVertices);
+	std::iota(coords.begin(), coords.end(), 0.0);
+	std::vector<double> uvs(2 * numIndices);
+	std::iota(uvs.begin(), uvs.end(), 0.0);
+	std::vector<double> normals(3 * numVertices);
+	std::iota(normals.begin(), normals.end(), 0.0);
+	std::vector<uint32_t> normalIndices(numIndices);
+	for (size_t i = 0; i < numIndices; i++)
+		normalIndices[i] = static_cast<uint32_t>(i / 4);
+
+	std::cout << "mesh output, " << numIndices << " indices:" << std::endl;
+
+	measure("  indices: per element", numIndices, repetitions, [&indices]() {
+		MIntArray mia(static_cast<unsigned int>(indices.size()), 0);
+		for (unsigned int i = 0; i < indices.size(); ++i)
+			mia.set(indices[i], i);
+		return size_t(mia.length());
+	});
+
+	measure("  indices: bulk", numIndices, repetitions, [&indices]() {
+		const MIntArray mia(reinterpret_cast<const int*>(indices.data()), static_cast<unsigned int>(indices.size()));
+		return size_t(mia.length());
+	});
+
+	measure("  points: per element", numVertices, repetitions, [&coords, numVertices]() {
+		MFloatPointArray mfpa(static_cast<unsigned int>(numVertices));
+		for (unsigned int i = 0; i < numVertices; ++i) {
+			mfpa.set(MFloatPoint(static_cast<float>(coords[i * 3 + 0]), static_cast<float>(coords[i * 3 + 1]),
+			                     static_cast<float>(coords[i * 3 + 2])),
+			         i);
+		}
+		return size_t(mfpa.length());
+	});
+
+	measure("  points: bulk", numVertices, repetitions, [&coords, numVertices]() {
+		MFloatPointArray mfpa;
+		mfpa.setLength(static_cast<unsigned int>(numVertices));
+		if (numVertices > 0)
+			prtu::narrowToPoints(coords.data(), &mfpa[0].x, numVertices);
+		return size_t(mfpa.length());
+	});
+
+	measure("  uvs: append", 2 * numIndices, repetitions, [&uvs, numIndices]() {
+		MFloatArray mU;
+		MFloatArray mV;
+		for (size_t uvIdx = 0; uvIdx < numIndices; ++uvIdx) {
+			mU.append(static_cast<float>(uvs[uvIdx * 2 + 0]));
+			mV.append(static_cast<float>(uvs[uvIdx * 2 + 1]));
+		}
+		return size_t(mU.length() + mV.length());
+	});
+
+	measure("  uvs: bulk", 2 * numIndices, repetitions, [&uvs, numIndices]() {
+		MFloatArray mU;
+		MFloatArray mV;
+		mU.setLength(static_cast<unsigned int>(numIndices));
+		mV.setLength(static_cast<unsigned int>(numIndices));
+		if (numIndices > 0)
+			prtu::narrowAndSplitUVs(uvs.data(), &mU[0], &mV[0], numIndices);
+		return size_t(mU.length() + mV.length());
+	});
+
+	measure("  normals: per element", numIndices, repetitions, [&normals, &normalIndices]() {
+		MVectorArray expandedNormals(static_cast<unsigned int>(normalIndices.size()));
+		for (unsigned int i = 0; i < normalIndices.size(); i++)
+			expandedNormals.set(&normals[normalIndices[i] * 3], i);
+		return size_t(expandedNormals.length());
+	});
+
+	measure("  normals: bulk", numIndices, repetitions, [&normals, &normalIndices]() {
+		MVectorArray expandedNormals;
+		expandedNormals.setLength(static_cast<unsigned int>(normalIndices.size()));
+		if (!normalIndices.empty()) {
+			double* dst = &expandedNormals[0].x;
+			for (size_t i = 0; i < normalIndices.size(); i++, dst += 3)
+				std::copy_n(&normals[3 * static_cast<size_t>(normalIndices[i])], 3, dst);
+		}
+		return size_t(expandedNormals.length());
+	});
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	const size_t numVertices = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	const size_t numIndices = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 10000000;
+	const size_t repetitions = (argc > 3) ? std::max<size_t>(std::strtoul(argv[3], nullptr, 10), 1) : 10;
+
+	measureVertexCoordinates(numVertices, repetitions);
+	measureMeshOutput(numIndices, repetitions);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures detail::serializeGeometry on a synthetic mesh set
+// usage: serlio_codec_benchmark [number of faces, default 1M] [repetitions, default 10]
+
+#include "encoder/MayaEncoder.h"
+
+#include "prtx/Geometry.h"
+#include "prtx/Material.h"
+#include "prtx/Mesh.h"
+
+#include "prt/API.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t GRID_SIZE = 32; // quads per mesh side, i.e. 1024 faces per mesh
+
+// planar grid of quads with vertex normals and the given number of uv sets
+prtx::MeshPtr createGridMesh(uint32_t numUVSets) {
+	constexpr uint32_t N = GRID_SIZE + 1;
+
+	prtx::DoubleVector coords, normals, uvs;
+	for (uint32_t y = 0; y < N; y++) {
+		for (uint32_t x = 0; x < N; x++) {
+			coords.insert(coords.end(), {double(x), 0.0, double(y)});
+			normals.insert(normals.end(), {0.0, 1.0, 0.0});
+			uvs.insert(uvs.end(), {double(x) / GRID_SIZE, double(y) / GRID_SIZE});
+		}
+	}
+
+	prtx::MeshBuilder mb;
+	mb.setVertexCoords(coords);
+	mb.setVertexNormalsCoords(normals);
+	for (uint32_t uvSet = 0; uvSet < numUVSets; uvSet++)
+		mb.setUVCoords(uvSet, uvs);
+
+	for (uint32_t y = 0; y < GRID_SIZE; y++) {
+		for (uint32_t x = 0; x < GRID_SIZE; x++) {
+			const uint32_t i = y * N + x;
+			const prtx::IndexVector indices = {i, i + N, i + N + 1, i + 1};
+			const uint32_t face = mb.addFace();
+			mb.setFaceVertexIndices(face, indices);
+			mb.setFaceVertexNormalIndices(face, indices);
+			for (uint32_t uvSet = 0; uvSet < numUVSets; uvSet++)
+				mb.setFaceUVIndices(face, uvSet, indices);
+		}
+	}
+	return mb.createShared();
+}
+
+prtx::GeometryPtr createGeometry(uint32_t numUVSets) {
+	prtx::GeometryBuilder gb;
+	gb.addMesh(createGridMesh(numUVSets));
+	return gb.createShared();
+}
+
+// T: scalar type of the serialized vertex data, see EO_FLOAT_VERTEX_DATA
+template <typename T>
+void measure(const char* label, const prtx::GeometryPtrVector& geos, const std::vector<prtx::MaterialPtrVector>& mats,
+             size_t numMeshes, size_t repetitions) {
+	for (const bool parallel : {false, true}) {
+		std::chrono::duration<double, std::milli> total{0}, best{std::numeric_limits<double>::max()};
+		for (size_t r = 0; r < repetitions; r++) {
+			const auto start = std::chrono::steady_clock::now();
+			const detail::SerializedGeometry<T> sg = detail::serializeGeometry<T>(geos, mats, parallel);
+			const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+			total += duration;
+			best = std::min(best, duration);
+			if (sg.counts.size() != numMeshes * GRID_SIZE * GRID_SIZE)
+				std::cerr << "unexpected face count " << sg.counts.size() << std::endl;
+		}
+
+		std::cout << "serializeGeometry<" << label << ">" << (parallel ? " (parallel)" : "") << ": "
+		          << numMeshes * GRID_SIZE * GRID_SIZE << " faces in " << numMeshes << " meshes, best "
+		          << best.count() << "ms, mean " << total.count() / repetitions << "ms" << std::endl;
+	}
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	const size_t numFaces = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	const size_t repetitions = (argc > 2) ? std::max<size_t>(std::strtoul(argv[2], nullptr, 10), 1) : 10;
+
+	prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+	const prt::Object* prt = prt::init(nullptr, 0, prt::LOG_WARNING, &status);
+	if (prt == nullptr || status != prt::STATUS_OK) {
+		std::cerr << "could not initialize PRT: " << prt::getStatusDescription(status) << std::endl;
+		return 1;
+	}
+
+	{
+		// mix meshes with one and two uv sets to also cover the filling of missing uv sets
+		const prtx::GeometryPtr geometries[] = {createGeometry(1), createGeometry(2)};
+		const prtx::MaterialPtr material = prtx::MaterialBuilder().createShared();
+
+		const size_t numMeshes = std::max<size_t>(numFaces / (GRID_SIZE * GRID_SIZE), 1);
+		prtx::GeometryPtrVector geos;
+		std::vector<prtx::MaterialPtrVector> mats;
+		for (size_t i = 0; i < numMeshes; i++) {
+			geos.push_back(geometries[i % 2]);
+			mats.push_back({material});
+		}
+
+		measure<double>("double", geos, mats, numMeshes, repetitions);
+		measure<float>("float", geos, mats, numMeshes, repetitions);
+	}
+
+	prt->destroy();
+	return 0;
+}
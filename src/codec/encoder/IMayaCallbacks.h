@@ -25,12 +25,16 @@ constexpr const wchar_t* ENCODER_ID_Maya = L"MayaEncoder";
 constexpr const wchar_t* EO_EMIT_ATTRIBUTES = L"emitAttributes";
 constexpr const wchar_t* EO_EMIT_MATERIALS = L"emitMaterials";
 constexpr const wchar_t* EO_EMIT_REPORTS = L"emitReports";
+constexpr const wchar_t* EO_PARALLEL_SERIALIZATION = L"parallelSerialization";
+constexpr const wchar_t* EO_EMIT_MESH_CHUNKS = L"emitMeshChunks";
+constexpr const wchar_t* EO_FLOAT_VERTEX_DATA = L"floatVertexData";
 
 class IMayaCallbacks : public prt::Callbacks {
 public:
 	~IMayaCallbacks() override = default;
 
 	/**
+	 * @param isIndex index of the initial shape in the generate call
 	 * @param name initial shape (primitive group) name, optionally used to create primitive groups on output
 	 * @param vtx vertex coordinate array
 	 * @param length of vertex coordinate array
@@ -43,6 +47,8 @@ public:
 	 * @param uvs array of texture coordinate arrays (same indexing as vertices per uv set)
 	 * @param uvsSizes lengths of uv arrays per uv set
 	 * @param uvSetsCount number of uv sets
+	 * @param uvSetSources per uv set the index of an identical (lower) uv set or its own index. The arrays of such an
+	 * alias point to the ones of its source, i.e. they are not duplicated and need to be converted only once.
 	 * @param faceRanges ranges for materials and reports
 	 * @param materials contains faceRangesSize-1 attribute maps (all materials must have an identical set of keys and
 	 * types)
@@ -50,7 +56,7 @@ public:
 	 * @param shapeIDs shape ids per face, contains faceRangesSize-1 values
 	 */
 	// clang-format off
-	virtual void addMesh(const wchar_t* name,
+	virtual void addMesh(size_t isIndex, const wchar_t* name,
 	                     const double* vtx, size_t vtxSize,
 	                     const double* nrm, size_t nrmSize,
 	                     const uint32_t* faceCounts, size_t faceCountsSize,
@@ -60,12 +66,107 @@ public:
 	                     double const* const* uvs, size_t const* uvsSizes,
 	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
 	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
-	                     size_t uvSets,
+	                     size_t uvSets, const uint32_t* uvSetSources,
 
 	                     const uint32_t* faceRanges, size_t faceRangesSize,
 	                     const prt::AttributeMap** materials,
 	                     const prt::AttributeMap** reports,
 	                     const int32_t* shapeIDs
 	) = 0;
+
+	/**
+	 * float variant of addMesh, used if the encoder option floatVertexData is set
+	 */
+	virtual void addMesh(size_t isIndex, const wchar_t* name,
+	                     const float* vtx, size_t vtxSize,
+	                     const float* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     float const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs
+	) = 0;
+	// clang-format on
+
+	/**
+	 * Starts a mesh which is streamed in chunks (one per instance) instead of a single addMesh call, used if the
+	 * encoder option emitMeshChunks is set. The sizes are the sums of the corresponding appendMeshChunk sizes over
+	 * all chunks, i.e. the arrays of the complete mesh can be allocated upfront.
+	 * @param isIndex index of the initial shape in the generate call
+	 * @param name initial shape (primitive group) name
+	 * @param vtxSize total number of vertex coordinates
+	 * @param faceCountsSize total number of faces
+	 * @param vertexIndicesSize total number of vertex indices (and normal indices)
+	 * @param uvsSizes total number of uv coordinates per uv set (aliased uv sets count the uvs of their source)
+	 * @param uvIndicesSizes total number of uv indices per uv set (likewise)
+	 * @param uvSets number of uv sets of all chunks
+	 */
+	virtual void beginMesh(size_t isIndex, const wchar_t* name, size_t vtxSize, size_t faceCountsSize,
+	                       size_t vertexIndicesSize, size_t const* uvsSizes, size_t const* uvIndicesSizes,
+	                       size_t uvSets) = 0;
+
+	/**
+	 * Appends a part of the mesh started with beginMesh, the parameters are the same as for addMesh. Indices and face
+	 * ranges are local to the chunk, the buffers are only valid during the call.
+	 */
+	// clang-format off
+	virtual void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                             const double* vtx, size_t vtxSize,
+	                             const double* nrm, size_t nrmSize,
+	                             const uint32_t* faceCounts, size_t faceCountsSize,
+	                             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                             double const* const* uvs, size_t const* uvsSizes,
+	                             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                             size_t uvSets, const uint32_t* uvSetSources,
+
+	                             const uint32_t* faceRanges, size_t faceRangesSize,
+	                             const prt::AttributeMap** materials,
+	                             const prt::AttributeMap** reports,
+	                             const int32_t* shapeIDs
+	) = 0;
+
+	/**
+	 * float variant of appendMeshChunk, used if the encoder option floatVertexData is set
+	 */
+	virtual void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                             const float* vtx, size_t vtxSize,
+	                             const float* nrm, size_t nrmSize,
+	                             const uint32_t* faceCounts, size_t faceCountsSize,
+	                             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                             float const* const* uvs, size_t const* uvsSizes,
+	                             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                             size_t uvSets, const uint32_t* uvSetSources,
+
+	                             const uint32_t* faceRanges, size_t faceRangesSize,
+	                             const prt::AttributeMap** materials,
+	                             const prt::AttributeMap** reports,
+	                             const int32_t* shapeIDs
+	) = 0;
 	// clang-format on
+
+	/**
+	 * Completes the mesh started with beginMesh.
+	 */
+	virtual void endMesh(size_t isIndex, const wchar_t* name) = 0;
+
+	/**
+	 * polled by the encoder while generating, returning true aborts the generate call with STATUS_CANCELED
+	 */
+	virtual bool isCanceled() const {
+		return false;
+	}
 };
@@ -36,12 +36,14 @@
 #include "prt/prt.h"
 
 #include <algorithm>
+#include <future>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <numeric>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 // PRT version < 2.1
@@ -68,25 +70,6 @@ constexpr bool DBG = false;
 constexpr const wchar_t* ENC_NAME = L"Autodesk(tm) Maya(tm) Encoder";
 constexpr const wchar_t* ENC_DESCRIPTION = L"Encodes geometry into the Maya format.";
 
-struct SerializedGeometry {
-	prtx::DoubleVector coords;
-	prtx::DoubleVector normals;
-	std::vector<uint32_t> counts;
-	std::vector<uint32_t> vertexIndices;
-	std::vector<uint32_t> normalIndices;
-
-	std::vector<prtx::DoubleVector> uvs;
-	std::vector<prtx::IndexVector> uvCounts;
-	std::vector<prtx::IndexVector> uvIndices;
-
-	SerializedGeometry(uint32_t numCounts, uint32_t numIndices, uint32_t uvSets)
-	    : uvs(uvSets), uvCounts(uvSets), uvIndices(uvSets) {
-		counts.reserve(numCounts);
-		vertexIndices.reserve(numIndices);
-		normalIndices.reserve(numIndices);
-	}
-};
-
 const prtx::EncodePreparator::PreparationFlags PREP_FLAGS =
         prtx::EncodePreparator::PreparationFlags()
                 .instancing(false)
@@ -106,13 +89,16 @@ std::vector<const wchar_t*> toPtrVec(const prtx::WStringVector& wsv) {
 	return pw;
 }
 
+// aliased entries (see SerializedGeometry::uvSetSources) point to the array of their source
 template <typename T>
-std::pair<std::vector<const T*>, std::vector<size_t>> toPtrVec(const std::vector<std::vector<T>>& v) {
+std::pair<std::vector<const T*>, std::vector<size_t>> toPtrVec(const std::vector<std::vector<T>>& v,
+                                                               const std::vector<uint32_t>& sources) {
 	std::vector<const T*> pv(v.size());
 	std::vector<size_t> ps(v.size());
 	for (size_t i = 0; i < v.size(); i++) {
-		pv[i] = v[i].data();
-		ps[i] = v[i].size();
+		const std::vector<T>& src = v[sources[i]];
+		pv[i] = src.data();
+		ps[i] = src.size();
 	}
 	return std::make_pair(pv, ps);
 }
@@ -395,29 +381,15 @@ uint32_t scanValidTextures(const prtx::MaterialPtr& mat) {
 		return highestUVSet + 1;
 }
 
-const prtx::DoubleVector EMPTY_UVS;
-const prtx::IndexVector EMPTY_IDX;
-
-} // namespace
-
-namespace detail {
-
-SerializedGeometry serializeGeometry(const prtx::GeometryPtrVector& geometries,
-                                     const std::vector<prtx::MaterialPtrVector>& materials) {
-	// PASS 1: scan
-	uint32_t numCounts = 0;
-	uint32_t numIndices = 0;
+// number of uv sets of the serialized geometry: the highest uv set of any mesh or required by its material
+uint32_t getMaxNumUVSets(const prtx::GeometryPtrVector& geometries,
+                         const std::vector<prtx::MaterialPtrVector>& materials) {
 	uint32_t maxNumUVSets = 0;
 	auto matsIt = materials.cbegin();
 	for (const auto& geo : geometries) {
-		const prtx::MeshPtrVector& meshes = geo->getMeshes();
 		const prtx::MaterialPtrVector& mats = *matsIt;
 		auto matIt = mats.cbegin();
-		for (const auto& mesh : meshes) {
-			numCounts += mesh->getFaceCount();
-			const auto& vtxCnts = mesh->getFaceVertexCounts();
-			numIndices = std::accumulate(vtxCnts.begin(), vtxCnts.end(), numIndices);
-
+		for (const auto& mesh : geo->getMeshes()) {
 			const prtx::MaterialPtr& mat = *matIt;
 			const uint32_t requiredUVSetsByMaterial = scanValidTextures(mat);
 			maxNumUVSets = std::max(maxNumUVSets, std::max(mesh->getUVSetsCount(), requiredUVSetsByMaterial));
@@ -425,85 +397,391 @@ SerializedGeometry serializeGeometry(const prtx::GeometryPtrVector& geometries,
 		}
 		++matsIt;
 	}
-	SerializedGeometry sg(numCounts, numIndices, maxNumUVSets);
+	return maxNumUVSets;
+}
+
+// the uv set of the mesh which provides the uvs for uvSet: missing (or empty) uv sets are filled with uv set 0,
+// -1 if the mesh has no uv sets at all
+int32_t getSourceUVSet(const prtx::Mesh& mesh, uint32_t uvSet) {
+	const uint32_t numUVSets = mesh.getUVSetsCount();
+	if (numUVSets == 0)
+		return -1;
+	if (uvSet < numUVSets && !mesh.getUVCoords(uvSet).empty())
+		return static_cast<int32_t>(uvSet);
+	return 0;
+}
+
+// meshes with fewer faces are not worth distributing onto several threads
+constexpr uint32_t PARALLEL_SERIALIZATION_MIN_FACES = 1u << 16;
+
+// start of the output ranges of a mesh in the serialized geometry (the uv set ranges are kept separately)
+struct MeshOffsets {
+	size_t coords = 0;
+	size_t normals = 0;
+	uint32_t counts = 0;
+	uint32_t indices = 0;
+};
+
+// plain loop over contiguous memory, vectorized by the compiler
+void rebaseIndices(const uint32_t* src, uint32_t count, uint32_t base, uint32_t* dst) {
+	std::transform(src, src + count, dst, [base](uint32_t i) { return base + i; });
+}
+
+// writes a mesh into its (disjoint) ranges of the pre-sized serialized geometry, safe to call concurrently
+template <typename T>
+void serializeMesh(detail::SerializedGeometry<T>& sg, const prtx::Mesh& mesh, const MeshOffsets& offsets,
+                   const size_t* uvCoordsOffsets, const size_t* uvIndicesOffsets) {
+	const uint32_t faceCount = mesh.getFaceCount();
+
+	// points and normals
+	const prtx::DoubleVector& verts = mesh.getVertexCoords();
+	std::copy(verts.begin(), verts.end(), sg.coords.begin() + offsets.coords);
+
+	const prtx::DoubleVector& norms = mesh.getVertexNormalsCoords();
+	std::copy(norms.begin(), norms.end(), sg.normals.begin() + offsets.normals);
+
+	// uv sets (uv coords, counts, indices) with special cases:
+	// - if mesh has no uv sets but there are uv sets in the output, the uv face counts stay "0" to keep in sync
+	// - if mesh has less uv sets than the output, uv set 0 is copied to the missing higher sets
+	if (DBG)
+		log_debug("-- mesh: numUVSets = %1%") % mesh.getUVSetsCount();
+
+	for (uint32_t uvSet = 0; uvSet < sg.uvs.size(); uvSet++) {
+		const int32_t srcUVSet = getSourceUVSet(mesh, uvSet);
+		if (srcUVSet < 0 || sg.uvSetSources[uvSet] != uvSet)
+			continue;
+
+		const prtx::DoubleVector& uvs = mesh.getUVCoords(srcUVSet);
+		std::copy(uvs.begin(), uvs.end(), sg.uvs[uvSet].begin() + uvCoordsOffsets[uvSet]);
+
+		const prtx::IndexVector& faceUVCounts = mesh.getFaceUVCounts(srcUVSet);
+		assert(faceUVCounts.size() == faceCount);
+		std::copy(faceUVCounts.begin(), faceUVCounts.end(), sg.uvCounts[uvSet].begin() + offsets.counts);
+		if (DBG)
+			log_debug("   -- uvset %1%: face counts size = %2%") % uvSet % faceUVCounts.size();
+
+		const uint32_t uvIndexBase = static_cast<uint32_t>(uvCoordsOffsets[uvSet] / 2);
+		uint32_t* tgtUVIdx = sg.uvIndices[uvSet].data() + uvIndicesOffsets[uvSet];
+		for (uint32_t fi = 0; fi < faceCount; ++fi) {
+			rebaseIndices(mesh.getFaceUVIndices(fi, srcUVSet), faceUVCounts[fi], uvIndexBase, tgtUVIdx);
+			tgtUVIdx += faceUVCounts[fi];
+		}
+	} // for all uv sets
+
+	// counts and indices for vertices and vertex normals
+	const uint32_t vertexIndexBase = static_cast<uint32_t>(offsets.coords / 3);
+	const uint32_t normalIndexBase = static_cast<uint32_t>(offsets.normals / 3);
+	uint32_t* tgtVtxIdx = sg.vertexIndices.data() + offsets.indices;
+	uint32_t* tgtNrmIdx = sg.normalIndices.data() + offsets.indices;
+	for (uint32_t fi = 0; fi < faceCount; ++fi) {
+		const uint32_t vtxCnt = mesh.getFaceVertexCount(fi);
+		sg.counts[offsets.counts + fi] = vtxCnt;
+		rebaseIndices(mesh.getFaceVertexIndices(fi), vtxCnt, vertexIndexBase, tgtVtxIdx);
+		rebaseIndices(mesh.getFaceVertexNormalIndices(fi), vtxCnt, normalIndexBase, tgtNrmIdx);
+		tgtVtxIdx += vtxCnt;
+		tgtNrmIdx += vtxCnt;
+	}
+}
+
+// sizes of a mesh which is streamed in chunks, i.e. the sums over the serialized geometries of all chunks
+struct MeshChunksSizes {
+	size_t coords = 0;
+	size_t counts = 0;
+	size_t indices = 0;
+	std::vector<size_t> uvCoords;  // per uv set
+	std::vector<size_t> uvIndices; // per uv set
+};
+
+// aliased uv sets (see SerializedGeometry::uvSetSources) are passed on with the arrays of their source, so every uv
+// set is counted with the uvs it is filled with
+MeshChunksSizes getMeshChunksSizes(const prtx::GeometryPtrVector& geometries, uint32_t numUVSets) {
+	MeshChunksSizes sizes;
+	sizes.uvCoords.resize(numUVSets, 0);
+	sizes.uvIndices.resize(numUVSets, 0);
+	for (const auto& geo : geometries) {
+		for (const auto& mesh : geo->getMeshes()) {
+			sizes.coords += mesh->getVertexCoords().size();
+			sizes.counts += mesh->getFaceCount();
+			const auto& vtxCnts = mesh->getFaceVertexCounts();
+			sizes.indices = std::accumulate(vtxCnts.begin(), vtxCnts.end(), sizes.indices);
+
+			for (uint32_t uvSet = 0; uvSet < numUVSets; uvSet++) {
+				const int32_t srcUVSet = getSourceUVSet(*mesh, uvSet);
+				if (srcUVSet < 0)
+					continue;
+				sizes.uvCoords[uvSet] += mesh->getUVCoords(srcUVSet).size();
+				const prtx::IndexVector& faceUVCounts = mesh->getFaceUVCounts(srcUVSet);
+				sizes.uvIndices[uvSet] =
+				        std::accumulate(faceUVCounts.begin(), faceUVCounts.end(), sizes.uvIndices[uvSet]);
+			}
+		}
+	}
+	return sizes;
+}
+
+} // namespace
+
+namespace detail {
+
+template <typename T>
+SerializedGeometry<T>::SerializedGeometry(size_t numCoords, size_t numNormals, uint32_t numCounts,
+                                          uint32_t numIndices, const std::vector<size_t>& numUVCoords,
+                                          const std::vector<size_t>& numUVIndices, std::vector<uint32_t> uvSetSources)
+    : coords(numCoords), normals(numNormals), counts(numCounts), vertexIndices(numIndices), normalIndices(numIndices),
+      uvs(numUVCoords.size()), uvCounts(numUVCoords.size()), uvIndices(numUVCoords.size()),
+      uvSetSources(std::move(uvSetSources)) {
+	assert(numUVCoords.size() == numUVIndices.size());
+	assert(numUVCoords.size() == this->uvSetSources.size());
+	for (size_t uvSet = 0; uvSet < numUVCoords.size(); uvSet++) {
+		if (this->uvSetSources[uvSet] != uvSet)
+			continue;
+		uvs[uvSet].resize(numUVCoords[uvSet]);
+		uvCounts[uvSet].resize(numCounts); // one (possibly zero) uv count per face
+		uvIndices[uvSet].resize(numUVIndices[uvSet]);
+	}
+}
+
+template <typename T>
+SerializedGeometry<T> serializeGeometry(const prtx::GeometryPtrVector& geometries,
+                                        const std::vector<prtx::MaterialPtrVector>& materials, bool parallel,
+                                        uint32_t minNumUVSets) {
+	// PASS 1: scan
+	std::vector<const prtx::Mesh*> meshes;
+	for (const auto& geo : geometries) {
+		for (const auto& mesh : geo->getMeshes())
+			meshes.push_back(mesh.get());
+	}
+	const uint32_t maxNumUVSets = std::max(minNumUVSets, getMaxNumUVSets(geometries, materials));
+
+	// a uv set which is filled with uv set 0 in all meshes is not materialized but passed on as an alias of uv set 0
+	std::vector<uint32_t> uvSetSources(maxNumUVSets);
+	std::iota(uvSetSources.begin(), uvSetSources.end(), 0u);
+	for (uint32_t uvSet = 1; uvSet < maxNumUVSets; uvSet++) {
+		const bool isCopyOfUVSet0 = std::all_of(meshes.begin(), meshes.end(), [uvSet](const prtx::Mesh* m) {
+			return getSourceUVSet(*m, uvSet) == getSourceUVSet(*m, 0);
+		});
+		if (isCopyOfUVSet0)
+			uvSetSources[uvSet] = 0;
+	}
+
+	// exclusive prefix sum over the mesh sizes, i.e. the output offsets of each mesh (and the totals at the end).
+	// The uv set sizes depend on maxNumUVSets because missing uv sets are filled with uv set 0.
+	const size_t numMeshes = meshes.size();
+	std::vector<MeshOffsets> offsets(numMeshes + 1);
+	std::vector<size_t> uvCoordsOffsets((numMeshes + 1) * maxNumUVSets, 0);  // [mesh][uv set]
+	std::vector<size_t> uvIndicesOffsets((numMeshes + 1) * maxNumUVSets, 0); // [mesh][uv set]
+	for (size_t mi = 0; mi < numMeshes; mi++) {
+		const prtx::Mesh& mesh = *meshes[mi];
+		const MeshOffsets& cur = offsets[mi];
+		MeshOffsets& next = offsets[mi + 1];
+		next.coords = cur.coords + mesh.getVertexCoords().size();
+		next.normals = cur.normals + mesh.getVertexNormalsCoords().size();
+		next.counts = cur.counts + mesh.getFaceCount();
+		const auto& vtxCnts = mesh.getFaceVertexCounts();
+		next.indices = std::accumulate(vtxCnts.begin(), vtxCnts.end(), cur.indices);
+
+		for (uint32_t uvSet = 0; uvSet < maxNumUVSets; uvSet++) {
+			const size_t curIdx = mi * maxNumUVSets + uvSet;
+			const size_t nextIdx = curIdx + maxNumUVSets;
+			uvCoordsOffsets[nextIdx] = uvCoordsOffsets[curIdx];
+			uvIndicesOffsets[nextIdx] = uvIndicesOffsets[curIdx];
+
+			const int32_t srcUVSet = getSourceUVSet(mesh, uvSet);
+			if (srcUVSet < 0 || uvSetSources[uvSet] != uvSet)
+				continue;
+			uvCoordsOffsets[nextIdx] += mesh.getUVCoords(srcUVSet).size();
+			const prtx::IndexVector& faceUVCounts = mesh.getFaceUVCounts(srcUVSet);
+			uvIndicesOffsets[nextIdx] =
+			        std::accumulate(faceUVCounts.begin(), faceUVCounts.end(), uvIndicesOffsets[nextIdx]);
+		}
+	}
+
+	const MeshOffsets& totals = offsets.back();
+	const std::vector<size_t> numUVCoords(uvCoordsOffsets.end() - maxNumUVSets, uvCoordsOffsets.end());
+	const std::vector<size_t> numUVIndices(uvIndicesOffsets.end() - maxNumUVSets, uvIndicesOffsets.end());
+	SerializedGeometry<T> sg(totals.coords, totals.normals, totals.counts, totals.indices, numUVCoords,
+	                         numUVIndices, std::move(uvSetSources));
 
 	// PASS 2: copy
-	uint32_t vertexIndexBase = 0u;
-	uint32_t normalIndexBase = 0u;
-	std::vector<uint32_t> uvIndexBases(maxNumUVSets, 0u);
+	const auto serializeMeshes = [&](size_t begin, size_t end) {
+		for (size_t mi = begin; mi < end; mi++)
+			serializeMesh(sg, *meshes[mi], offsets[mi], uvCoordsOffsets.data() + mi * maxNumUVSets,
+			              uvIndicesOffsets.data() + mi * maxNumUVSets);
+	};
+
+	const size_t numThreads = (parallel && totals.counts >= PARALLEL_SERIALIZATION_MIN_FACES)
+	                                  ? std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), numMeshes)
+	                                  : 1;
+	if (numThreads <= 1) {
+		serializeMeshes(0, numMeshes);
+		return sg;
+	}
+
+	// split the meshes into chunks of roughly equal face count, the first one is serialized on this thread
+	std::vector<std::pair<size_t, size_t>> chunks;
+	size_t chunkBegin = 0;
+	for (size_t t = 1; t <= numThreads; t++) {
+		const uint64_t faceLimit = static_cast<uint64_t>(totals.counts) * t / numThreads;
+		const auto chunkEnd = std::lower_bound(offsets.begin() + chunkBegin, offsets.end() - 1, faceLimit,
+		                                       [](const MeshOffsets& o, uint64_t f) { return o.counts < f; });
+		const size_t chunkEndIdx = (t == numThreads) ? numMeshes : chunkEnd - offsets.begin();
+		if (chunkEndIdx > chunkBegin)
+			chunks.emplace_back(chunkBegin, chunkEndIdx);
+		chunkBegin = chunkEndIdx;
+	}
+
+	std::vector<std::future<void>> pending;
+	for (size_t c = 1; c < chunks.size(); c++)
+		pending.emplace_back(std::async(std::launch::async, serializeMeshes, chunks[c].first, chunks[c].second));
+	serializeMeshes(chunks.front().first, chunks.front().second);
+	for (auto& p : pending)
+		p.get();
+
+	return sg;
+}
+
+template struct SerializedGeometry<double>;
+template struct SerializedGeometry<float>;
+template SerializedGeometry<double> serializeGeometry<double>(const prtx::GeometryPtrVector&,
+                                                              const std::vector<prtx::MaterialPtrVector>&, bool,
+                                                              uint32_t);
+template SerializedGeometry<float> serializeGeometry<float>(const prtx::GeometryPtrVector&,
+                                                            const std::vector<prtx::MaterialPtrVector>&, bool,
+                                                            uint32_t);
+
+} // namespace detail
+
+namespace {
+
+// the encoder options which control the conversion of the geometry
+struct GeometryEmitOptions {
+	bool emitMaterials = true;
+	bool emitReports = false;
+	bool parallelSerialization = false;
+	bool emitMeshChunks = false;
+	bool floatVertexData = false;
+};
+
+// passes the serialized geometry to addMesh or, for a chunk, to appendMeshChunk
+template <typename T>
+void emitMesh(IMayaCallbacks* cb, size_t isIndex, const wchar_t* name, const detail::SerializedGeometry<T>& sg,
+              const prtx::GeometryPtrVector& geometries, const std::vector<prtx::MaterialPtrVector>& materials,
+              const std::vector<prtx::ReportsPtr>& reports, const std::vector<int32_t>& shapeIDs,
+              const GeometryEmitOptions& opts, bool isChunk) {
+	uint32_t faceCount = 0;
+	std::vector<uint32_t> faceRanges;
+	std::vector<int32_t> meshShapeIDs; // one per face range
+	AttributeMapNOPtrVectorOwner matAttrMaps;
+	AttributeMapNOPtrVectorOwner reportAttrMaps;
+
+	assert(geometries.size() == reports.size());
+	assert(materials.size() == reports.size());
+	assert(shapeIDs.size() == reports.size());
+	auto matIt = materials.cbegin();
+	auto repIt = reports.cbegin();
+	auto shapeIDIt = shapeIDs.cbegin();
+	prtx::PRTUtils::AttributeMapBuilderPtr amb(prt::AttributeMapBuilder::create());
 	for (const auto& geo : geometries) {
 		const prtx::MeshPtrVector& meshes = geo->getMeshes();
-		for (const auto& mesh : meshes) {
-			// append points
-			const prtx::DoubleVector& verts = mesh->getVertexCoords();
-			sg.coords.insert(sg.coords.end(), verts.begin(), verts.end());
-
-			// append normals
-			const prtx::DoubleVector& norms = mesh->getVertexNormalsCoords();
-			sg.normals.insert(sg.normals.end(), norms.begin(), norms.end());
-
-			// append uv sets (uv coords, counts, indices) with special cases:
-			// - if mesh has no uv sets but maxNumUVSets is > 0, insert "0" uv face counts to keep in sync
-			// - if mesh has less uv sets than maxNumUVSets, copy uv set 0 to the missing higher sets
-			const uint32_t numUVSets = mesh->getUVSetsCount();
-			const prtx::DoubleVector& uvs0 = (numUVSets > 0) ? mesh->getUVCoords(0) : EMPTY_UVS;
-			const prtx::IndexVector faceUVCounts0 =
-			        (numUVSets > 0) ? mesh->getFaceUVCounts(0) : prtx::IndexVector(mesh->getFaceCount(), 0);
-			if (DBG)
-				log_debug("-- mesh: numUVSets = %1%") % numUVSets;
-
-			for (uint32_t uvSet = 0; uvSet < sg.uvs.size(); uvSet++) {
-				// append texture coordinates
-				const prtx::DoubleVector& uvs = (uvSet < numUVSets) ? mesh->getUVCoords(uvSet) : EMPTY_UVS;
-				const auto& src = uvs.empty() ? uvs0 : uvs;
-				auto& tgt = sg.uvs[uvSet];
-				tgt.insert(tgt.end(), src.begin(), src.end());
-
-				// append uv face counts
-				const prtx::IndexVector& faceUVCounts =
-				        (uvSet < numUVSets && !uvs.empty()) ? mesh->getFaceUVCounts(uvSet) : faceUVCounts0;
-				assert(faceUVCounts.size() == mesh->getFaceCount());
-				auto& tgtCnts = sg.uvCounts[uvSet];
-				tgtCnts.insert(tgtCnts.end(), faceUVCounts.begin(), faceUVCounts.end());
+
+		for (size_t mi = 0; mi < meshes.size(); mi++) {
+			const prtx::MeshPtr& m = meshes.at(mi);
+			const prtx::MaterialPtr& mat = matIt->at(mi);
+
+			faceRanges.push_back(faceCount);
+			meshShapeIDs.push_back(*shapeIDIt);
+
+			if (opts.emitMaterials) {
+				convertMaterialToAttributeMap(amb, *(mat.get()), mat->getKeys());
+				matAttrMaps.v.push_back(amb->createAttributeMapAndReset());
+			}
+
+			if (opts.emitReports) {
+				convertReportsToAttributeMap(amb, *repIt);
+				reportAttrMaps.v.push_back(amb->createAttributeMapAndReset());
 				if (DBG)
-					log_debug("   -- uvset %1%: face counts size = %2%") % uvSet % faceUVCounts.size();
-
-				// append uv vertex indices
-				for (uint32_t fi = 0, faceCount = static_cast<uint32_t>(faceUVCounts.size()); fi < faceCount; ++fi) {
-					const uint32_t* faceUVIdx0 = (numUVSets > 0) ? mesh->getFaceUVIndices(fi, 0) : EMPTY_IDX.data();
-					const uint32_t* faceUVIdx =
-					        (uvSet < numUVSets && !uvs.empty()) ? mesh->getFaceUVIndices(fi, uvSet) : faceUVIdx0;
-					const uint32_t faceUVCnt = faceUVCounts[fi];
-					if (DBG)
-						log_debug("      fi %1%: faceUVCnt = %2%, faceVtxCnt = %3%") % fi % faceUVCnt %
-						        mesh->getFaceVertexCount(fi);
-					for (uint32_t vi = 0; vi < faceUVCnt; vi++)
-						sg.uvIndices[uvSet].push_back(uvIndexBases[uvSet] + faceUVIdx[vi]);
-				}
-
-				uvIndexBases[uvSet] += static_cast<uint32_t>(src.size()) / 2;
-			} // for all uv sets
-
-			// append counts and indices for vertices and vertex normals
-			for (uint32_t fi = 0, faceCount = mesh->getFaceCount(); fi < faceCount; ++fi) {
-				const uint32_t vtxCnt = mesh->getFaceVertexCount(fi);
-				sg.counts.push_back(vtxCnt);
-				const uint32_t* vtxIdx = mesh->getFaceVertexIndices(fi);
-				const uint32_t* nrmIdx = mesh->getFaceVertexNormalIndices(fi);
-				for (uint32_t vi = 0; vi < vtxCnt; vi++) {
-					sg.vertexIndices.push_back(vertexIndexBase + vtxIdx[vi]);
-					sg.normalIndices.push_back(normalIndexBase + nrmIdx[vi]);
-				}
+					log_debug("report attr map: %1%") % prtx::PRTUtils::objectToXML(reportAttrMaps.v.back());
 			}
 
-			vertexIndexBase += (uint32_t)verts.size() / 3u;
-			normalIndexBase += (uint32_t)norms.size() / 3u;
-		} // for all meshes
-	}     // for all geometries
+			faceCount += m->getFaceCount();
+		}
 
-	return sg;
+		++matIt;
+		++repIt;
+		++shapeIDIt;
+	}
+	faceRanges.push_back(faceCount); // close last range
+
+	assert(meshShapeIDs.size() == faceRanges.size() - 1);
+	assert(matAttrMaps.v.empty() || matAttrMaps.v.size() == faceRanges.size() - 1);
+	assert(reportAttrMaps.v.empty() || reportAttrMaps.v.size() == faceRanges.size() - 1);
+
+	if (!isChunk && cb->isCanceled())
+		throw prtx::StatusException(prt::STATUS_CANCELED);
+
+	auto puvs = toPtrVec(sg.uvs, sg.uvSetSources);
+	auto puvCounts = toPtrVec(sg.uvCounts, sg.uvSetSources);
+	auto puvIndices = toPtrVec(sg.uvIndices, sg.uvSetSources);
+
+	const prt::AttributeMap** pMatAttrMaps = matAttrMaps.v.empty() ? nullptr : matAttrMaps.v.data();
+	const prt::AttributeMap** pReportAttrMaps = reportAttrMaps.v.empty() ? nullptr : reportAttrMaps.v.data();
+
+	if (isChunk) {
+		cb->appendMeshChunk(isIndex, name, sg.coords.data(), sg.coords.size(), sg.normals.data(), sg.normals.size(),
+		                    sg.counts.data(), sg.counts.size(), sg.vertexIndices.data(), sg.vertexIndices.size(),
+		                    sg.normalIndices.data(), sg.normalIndices.size(),
+
+		                    puvs.first.data(), puvs.second.data(), puvCounts.first.data(), puvCounts.second.data(),
+		                    puvIndices.first.data(), puvIndices.second.data(), sg.uvs.size(), sg.uvSetSources.data(),
+
+		                    faceRanges.data(), faceRanges.size(), pMatAttrMaps, pReportAttrMaps, meshShapeIDs.data());
+	}
+	else {
+		cb->addMesh(isIndex, name, sg.coords.data(), sg.coords.size(), sg.normals.data(), sg.normals.size(),
+		            sg.counts.data(), sg.counts.size(), sg.vertexIndices.data(), sg.vertexIndices.size(),
+		            sg.normalIndices.data(), sg.normalIndices.size(),
+
+		            puvs.first.data(), puvs.second.data(), puvCounts.first.data(), puvCounts.second.data(),
+		            puvIndices.first.data(), puvIndices.second.data(), sg.uvs.size(), sg.uvSetSources.data(),
+
+		            faceRanges.data(), faceRanges.size(), pMatAttrMaps, pReportAttrMaps, meshShapeIDs.data());
+	}
 }
-} // namespace detail
+
+// serializes the geometry with scalar type T and passes it on as one mesh or streamed per instance
+template <typename T>
+void emitGeometry(IMayaCallbacks* cb, size_t isIndex, const wchar_t* name, const prtx::GeometryPtrVector& geometries,
+                  const std::vector<prtx::MaterialPtrVector>& materials, const std::vector<prtx::ReportsPtr>& reports,
+                  const std::vector<int32_t>& shapeIDs, const GeometryEmitOptions& opts) {
+	if (opts.emitMeshChunks) {
+		// stream one chunk per instance, the uv set count must be the same for all chunks
+		const uint32_t numUVSets = getMaxNumUVSets(geometries, materials);
+		const MeshChunksSizes sizes = getMeshChunksSizes(geometries, numUVSets);
+		cb->beginMesh(isIndex, name, sizes.coords, sizes.counts, sizes.indices, sizes.uvCoords.data(),
+		              sizes.uvIndices.data(), numUVSets);
+		for (size_t gi = 0; gi < geometries.size(); gi++) {
+			if (cb->isCanceled())
+				throw prtx::StatusException(prt::STATUS_CANCELED);
+
+			const prtx::GeometryPtrVector chunkGeometries = {geometries[gi]};
+			const std::vector<prtx::MaterialPtrVector> chunkMaterials = {materials[gi]};
+			const std::vector<prtx::ReportsPtr> chunkReports = {reports[gi]};
+			const std::vector<int32_t> chunkShapeIDs = {shapeIDs[gi]};
+
+			const detail::SerializedGeometry<T> sg = detail::serializeGeometry<T>(
+			        chunkGeometries, chunkMaterials, opts.parallelSerialization, numUVSets);
+			emitMesh(cb, isIndex, name, sg, chunkGeometries, chunkMaterials, chunkReports, chunkShapeIDs, opts, true);
+		}
+		cb->endMesh(isIndex, name);
+	}
+	else {
+		const detail::SerializedGeometry<T> sg =
+		        detail::serializeGeometry<T>(geometries, materials, opts.parallelSerialization);
+		emitMesh(cb, isIndex, name, sg, geometries, materials, reports, shapeIDs, opts, false);
+	}
+}
+
+} // namespace
 
 MayaEncoder::MayaEncoder(const std::wstring& id, const prt::AttributeMap* options, prt::Callbacks* callbacks)
     : prtx::GeometryEncoder(id, options, callbacks) {}
@@ -536,6 +814,10 @@ void MayaEncoder::encode(prtx::GenerateContext& context, size_t initialShapeInde
 	        prtx::LeafShapeReportingStrategy::create(context, initialShapeIndex, reportsAccumulator)};
 	prtx::LeafIteratorPtr li = prtx::LeafIterator::create(context, initialShapeIndex);
 	for (prtx::ShapePtr shape = li->getNext(); shape; shape = li->getNext()) {
+		// the leaf iterator drives the derivation, so this is where we can abort an outdated generate
+		if (cb->isCanceled())
+			throw prtx::StatusException(prt::STATUS_CANCELED);
+
 		prtx::ReportsPtr r = reportsCollector->getReports(shape->getID());
 		encPrep->add(context.getCache(), shape, initialShape.getAttributeMap(), r);
 
@@ -546,13 +828,17 @@ void MayaEncoder::encode(prtx::GenerateContext& context, size_t initialShapeInde
 
 	prtx::EncodePreparator::InstanceVector instances;
 	encPrep->fetchFinalizedInstances(instances, PREP_FLAGS);
-	convertGeometry(initialShape, instances, cb);
+	convertGeometry(initialShape, initialShapeIndex, instances, cb);
 }
 
-void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape,
+void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape, size_t initialShapeIndex,
                                   const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* cb) {
-	const bool emitMaterials = getOptions()->getBool(EO_EMIT_MATERIALS);
-	const bool emitReports = getOptions()->getBool(EO_EMIT_REPORTS);
+	GeometryEmitOptions opts;
+	opts.emitMaterials = getOptions()->getBool(EO_EMIT_MATERIALS);
+	opts.emitReports = getOptions()->getBool(EO_EMIT_REPORTS);
+	opts.parallelSerialization = getOptions()->getBool(EO_PARALLEL_SERIALIZATION);
+	opts.emitMeshChunks = getOptions()->getBool(EO_EMIT_MESH_CHUNKS);
+	opts.floatVertexData = getOptions()->getBool(EO_FLOAT_VERTEX_DATA);
 
 	prtx::GeometryPtrVector geometries;
 	std::vector<prtx::MaterialPtrVector> materials;
@@ -571,69 +857,17 @@ void MayaEncoder::convertGeometry(const prtx::InitialShape& initialShape,
 		shapeIDs.push_back(inst.getShapeId());
 	}
 
-	const SerializedGeometry sg = detail::serializeGeometry(geometries, materials);
-
 	if (DBG) {
 		log_debug("resolvemap: %s") % prtx::PRTUtils::objectToXML(initialShape.getResolveMap());
 		log_debug("encoder #materials = %s") % materials.size();
 	}
 
-	uint32_t faceCount = 0;
-	std::vector<uint32_t> faceRanges;
-	AttributeMapNOPtrVectorOwner matAttrMaps;
-	AttributeMapNOPtrVectorOwner reportAttrMaps;
-
-	assert(geometries.size() == reports.size());
-	assert(materials.size() == reports.size());
-	auto matIt = materials.cbegin();
-	auto repIt = reports.cbegin();
-	prtx::PRTUtils::AttributeMapBuilderPtr amb(prt::AttributeMapBuilder::create());
-	for (const auto& geo : geometries) {
-		const prtx::MeshPtrVector& meshes = geo->getMeshes();
-
-		for (size_t mi = 0; mi < meshes.size(); mi++) {
-			const prtx::MeshPtr& m = meshes.at(mi);
-			const prtx::MaterialPtr& mat = matIt->at(mi);
-
-			faceRanges.push_back(faceCount);
-
-			if (emitMaterials) {
-				convertMaterialToAttributeMap(amb, *(mat.get()), mat->getKeys());
-				matAttrMaps.v.push_back(amb->createAttributeMapAndReset());
-			}
-
-			if (emitReports) {
-				convertReportsToAttributeMap(amb, *repIt);
-				reportAttrMaps.v.push_back(amb->createAttributeMapAndReset());
-				if (DBG)
-					log_debug("report attr map: %1%") % prtx::PRTUtils::objectToXML(reportAttrMaps.v.back());
-			}
-
-			faceCount += m->getFaceCount();
-		}
-
-		++matIt;
-		++repIt;
-	}
-	faceRanges.push_back(faceCount); // close last range
-
-	assert(matAttrMaps.v.empty() || matAttrMaps.v.size() == faceRanges.size() - 1);
-	assert(reportAttrMaps.v.empty() || reportAttrMaps.v.size() == faceRanges.size() - 1);
-	assert(shapeIDs.size() == faceRanges.size() - 1);
-
-	auto puvs = toPtrVec(sg.uvs);
-	auto puvCounts = toPtrVec(sg.uvCounts);
-	auto puvIndices = toPtrVec(sg.uvIndices);
-
-	cb->addMesh(initialShape.getName(), sg.coords.data(), sg.coords.size(), sg.normals.data(), sg.normals.size(),
-	            sg.counts.data(), sg.counts.size(), sg.vertexIndices.data(), sg.vertexIndices.size(),
-	            sg.normalIndices.data(), sg.normalIndices.size(),
-
-	            puvs.first.data(), puvs.second.data(), puvCounts.first.data(), puvCounts.second.data(),
-	            puvIndices.first.data(), puvIndices.second.data(), sg.uvs.size(),
-
-	            faceRanges.data(), faceRanges.size(), matAttrMaps.v.empty() ? nullptr : matAttrMaps.v.data(),
-	            reportAttrMaps.v.empty() ? nullptr : reportAttrMaps.v.data(), shapeIDs.data());
+	if (opts.floatVertexData)
+		emitGeometry<float>(cb, initialShapeIndex, initialShape.getName(), geometries, materials, reports, shapeIDs,
+		                    opts);
+	else
+		emitGeometry<double>(cb, initialShapeIndex, initialShape.getName(), geometries, materials, reports, shapeIDs,
+		                     opts);
 
 	if (DBG)
 		srl_log_debug(L"MayaEncoder::convertGeometry: end");
@@ -653,6 +887,9 @@ MayaEncoderFactory* MayaEncoderFactory::createInstance() {
 	amb->setBool(EO_EMIT_ATTRIBUTES, prtx::PRTX_TRUE);
 	amb->setBool(EO_EMIT_MATERIALS, prtx::PRTX_TRUE);
 	amb->setBool(EO_EMIT_REPORTS, prtx::PRTX_FALSE);
+	amb->setBool(EO_PARALLEL_SERIALIZATION, prtx::PRTX_FALSE);
+	amb->setBool(EO_EMIT_MESH_CHUNKS, prtx::PRTX_FALSE);
+	amb->setBool(EO_FLOAT_VERTEX_DATA, prtx::PRTX_FALSE);
 	encoderInfoBuilder.setDefaultOptions(amb->createAttributeMap());
 
 	return new MayaEncoderFactory(encoderInfoBuilder.create());
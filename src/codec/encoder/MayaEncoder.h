@@ -25,6 +25,8 @@
 #include "prtx/Encoder.h"
 #include "prtx/EncoderFactory.h"
 #include "prtx/EncoderInfoBuilder.h"
+#include "prtx/Geometry.h"
+#include "prtx/Material.h"
 #include "prtx/PRTUtils.h"
 #include "prtx/ResolveMap.h"
 #include "prtx/Singleton.h"
@@ -35,9 +37,42 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 class IMayaCallbacks;
 
+namespace detail {
+
+// T is the scalar type of the coordinates, normals and uvs: double or float (see EO_FLOAT_VERTEX_DATA)
+template <typename T>
+struct SerializedGeometry {
+	std::vector<T> coords;
+	std::vector<T> normals;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> vertexIndices;
+	std::vector<uint32_t> normalIndices;
+
+	std::vector<std::vector<T>> uvs;
+	std::vector<prtx::IndexVector> uvCounts;
+	std::vector<prtx::IndexVector> uvIndices;
+	std::vector<uint32_t> uvSetSources; // uv sets identical to a lower one stay empty, see IMayaCallbacks::addMesh
+
+	// all arrays are allocated with their final size upfront and then filled by indexed writes
+	SerializedGeometry(size_t numCoords, size_t numNormals, uint32_t numCounts, uint32_t numIndices,
+	                   const std::vector<size_t>& numUVCoords, const std::vector<size_t>& numUVIndices,
+	                   std::vector<uint32_t> uvSetSources);
+};
+
+// merges the meshes of all geometries into a single mesh (in the layout expected by IMayaCallbacks::addMesh),
+// in parallel mode large mesh sets are copied by several threads. minNumUVSets allows to serialize several parts of
+// a mesh with a consistent number of uv sets. Instantiated for double and float.
+template <typename T>
+SerializedGeometry<T> serializeGeometry(const prtx::GeometryPtrVector& geometries,
+                                        const std::vector<prtx::MaterialPtrVector>& materials, bool parallel = false,
+                                        uint32_t minNumUVSets = 0);
+
+} // namespace detail
+
 class MayaEncoder : public prtx::GeometryEncoder {
 public:
 	MayaEncoder(const std::wstring& id, const prt::AttributeMap* options, prt::Callbacks* callbacks);
@@ -49,7 +84,7 @@ public:
 	void finish(prtx::GenerateContext& context) override;
 
 private:
-	void convertGeometry(const prtx::InitialShape& initialShape,
+	void convertGeometry(const prtx::InitialShape& initialShape, size_t initialShapeIndex,
 	                     const prtx::EncodePreparator::InstanceVector& instances, IMayaCallbacks* callbacks);
 };
 
@@ -21,6 +21,8 @@
 
 #include "utils/LogHandler.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <mutex>
 
 namespace {
@@ -33,6 +35,54 @@ constexpr prt::LogLevel PRT_LOG_LEVEL = prt::LOG_INFO;
 constexpr bool ENABLE_LOG_CONSOLE = true;
 constexpr bool ENABLE_LOG_FILE = false;
 
+// optional override of ResolveMapCache::DEFAULT_REVALIDATION_INTERVAL in milliseconds
+constexpr const char* SRL_ENV_RPK_REVALIDATION_INTERVAL = "SERLIO_RPK_REVALIDATION_INTERVAL";
+// optional overrides of the ResolveMapCache limits (number of RPKs and megabytes of unpacked RPK files)
+constexpr const char* SRL_ENV_RPK_CACHE_MAX_ENTRIES = "SERLIO_RPK_CACHE_MAX_ENTRIES";
+constexpr const char* SRL_ENV_RPK_CACHE_MAX_SIZE = "SERLIO_RPK_CACHE_MAX_SIZE";
+// PRT cache type: "default" or "nonredundant" (keeps only one copy of identical assets/textures, less memory)
+constexpr const char* SRL_ENV_PRT_CACHE_TYPE = "SERLIO_PRT_CACHE_TYPE";
+// opt-in: existing directory to keep unpacked RPKs across sessions, can be shared by several processes
+constexpr const char* SRL_ENV_RPK_CACHE_DIR = "SERLIO_RPK_CACHE_DIR";
+
+std::wstring getPersistentRPKUnpackPath() {
+	const char* dir = std::getenv(SRL_ENV_RPK_CACHE_DIR);
+	if (dir == nullptr || *dir == 0)
+		return {};
+
+	const std::wstring path = prtu::toUTF16FromOSNarrow(dir);
+	if (prtu::getFileModificationTime(path) == -1) {
+		LOG_WRN << SRL_ENV_RPK_CACHE_DIR << " is set to " << path << " which does not exist, ignoring it";
+		return {};
+	}
+	LOG_INF << "using persistent RPK cache directory " << path;
+	return path;
+}
+
+prt::CacheObject::CacheType getPRTCacheType() {
+	const char* type = std::getenv(SRL_ENV_PRT_CACHE_TYPE);
+	if (type == nullptr || *type == 0 || std::strcmp(type, "default") == 0)
+		return prt::CacheObject::CACHE_TYPE_DEFAULT;
+	if (std::strcmp(type, "nonredundant") == 0) {
+		LOG_INF << "using non-redundant PRT cache";
+		return prt::CacheObject::CACHE_TYPE_NONREDUNDANT;
+	}
+	LOG_WRN << SRL_ENV_PRT_CACHE_TYPE << " has unknown value " << type << ", using default PRT cache";
+	return prt::CacheObject::CACHE_TYPE_DEFAULT;
+}
+
+// the PRT cache keys its entries (decoded rule files, assets, textures) by URI, drop the ones of an evicted RPK
+void flushCacheEntries(prt::CacheObject& cache, const prt::ResolveMap& resolveMap) {
+	size_t keyCount = 0;
+	const wchar_t* const* keys = resolveMap.getKeys(&keyCount);
+	for (size_t k = 0; k < keyCount; k++) {
+		if (const wchar_t* uri = resolveMap.getString(keys[k]))
+			cache.flushEntry(uri);
+	}
+	if (DBG)
+		LOG_DBG << "flushed " << keyCount << " PRT cache entries of evicted RPK";
+}
+
 bool verifyMayaEncoder() {
 	constexpr const wchar_t* ENC_ID_MAYA = L"MayaEncoder";
 	const auto mayaEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA);
@@ -85,14 +135,37 @@ PRTContext::PRTContext(const std::vector<std::wstring>& addExtDirs) : mPluginRoo
 		thePRT.reset();
 	}
 	else {
-		theCache.reset(prt::CacheObject::create(prt::CacheObject::CACHE_TYPE_DEFAULT));
-		mResolveMapCache = std::make_unique<ResolveMapCache>(prtu::getProcessTempDir(SRL_TMP_PREFIX));
+		theCache.reset(prt::CacheObject::create(getPRTCacheType()));
+		mResolveMapCache = std::make_unique<ResolveMapCache>(prtu::getProcessTempDir(SRL_TMP_PREFIX),
+		                                                     getPersistentRPKUnpackPath());
+		mResolveMapCache->setEvictionCallback([this](const prt::ResolveMap& resolveMap) {
+			if (theCache)
+				flushCacheEntries(*theCache, resolveMap);
+		});
+		if (const char* interval = std::getenv(SRL_ENV_RPK_REVALIDATION_INTERVAL)) {
+			mResolveMapCache->setRevalidationInterval(std::chrono::milliseconds(std::strtol(interval, nullptr, 10)));
+			LOG_INF << "RPK revalidation interval set to " << interval << "ms";
+		}
+
+		const char* maxEntries = std::getenv(SRL_ENV_RPK_CACHE_MAX_ENTRIES);
+		const char* maxSize = std::getenv(SRL_ENV_RPK_CACHE_MAX_SIZE);
+		if (maxEntries != nullptr || maxSize != nullptr) {
+			const size_t maxEntriesValue = (maxEntries != nullptr) ? std::strtoul(maxEntries, nullptr, 10)
+			                                                       : ResolveMapCache::DEFAULT_MAX_ENTRIES;
+			const uint64_t maxBytesValue = (maxSize != nullptr) ? std::strtoull(maxSize, nullptr, 10) << 20
+			                                                    : ResolveMapCache::DEFAULT_MAX_UNPACKED_BYTES;
+			mResolveMapCache->setLimits(maxEntriesValue, maxBytesValue);
+			LOG_INF << "RPK cache limits set to " << maxEntriesValue << " entries and " << (maxBytesValue >> 20)
+			        << "MB";
+		}
+		mDefaultAttributeValuesCache = std::make_unique<DefaultAttributeValuesCache>();
 	}
 }
 
 PRTContext::~PRTContext() {
 
-	// the cache needs to be destructed before PRT, so reset them explicitely in the right order here
+	// the caches need to be destructed before PRT, so reset them explicitely in the right order here
+	mDefaultAttributeValuesCache.reset();
 	theCache.reset();
 	thePRT.reset();
 
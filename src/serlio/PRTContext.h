@@ -21,6 +21,7 @@
 
 #include "serlioPlugin.h"
 
+#include "utils/DefaultAttributeValuesCache.h"
 #include "utils/ResolveMapCache.h"
 #include "utils/Utilities.h"
 
@@ -50,4 +51,5 @@ struct SRL_TEST_EXPORTS_API PRTContext final {
 	prt::ConsoleLogHandler* theLogHandler = nullptr;
 	prt::FileLogHandler* theFileLogHandler = nullptr;
 	ResolveMapCacheUPtr mResolveMapCache;
+	DefaultAttributeValuesCacheUPtr mDefaultAttributeValuesCache;
 };
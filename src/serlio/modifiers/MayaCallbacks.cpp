@@ -33,10 +33,13 @@
 #include "maya/MFloatVectorArray.h"
 #include "maya/MFnMesh.h"
 #include "maya/MFnMeshData.h"
+#include "maya/MVectorArray.h"
 #include "maya/adskDataAssociations.h"
 #include "maya/adskDataStream.h"
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
 #include <sstream>
 
 namespace {
@@ -50,25 +53,69 @@ void checkStringLength(const wchar_t* string, const size_t& maxStringLength) {
 	}
 }
 
+// maya and prt indices have the same size, so we can construct the maya array directly from the prt buffer
 MIntArray toMayaIntArray(uint32_t const* a, size_t s) {
-	MIntArray mia(static_cast<unsigned int>(s), 0);
-	for (unsigned int i = 0; i < s; ++i)
-		mia.set(a[i], i);
-	return mia;
+	static_assert(sizeof(int) == sizeof(uint32_t), "bulk copy of index arrays requires 32bit int");
+	return MIntArray(reinterpret_cast<const int*>(a), static_cast<unsigned int>(s));
 }
 
-MFloatPointArray toMayaFloatPointArray(double const* a, size_t s) {
+// conversion of the double or float vertex data of the encoder (see EO_FLOAT_VERTEX_DATA) into the maya layouts
+void toMayaPoints(const double* src, float* dst, size_t numPoints) {
+	prtu::narrowToPoints(src, dst, numPoints);
+}
+void toMayaPoints(const float* src, float* dst, size_t numPoints) {
+	prtu::toPoints(src, dst, numPoints);
+}
+void toMayaUVs(const double* src, float* dstU, float* dstV, size_t numUVs) {
+	prtu::narrowAndSplitUVs(src, dstU, dstV, numUVs);
+}
+void toMayaUVs(const float* src, float* dstU, float* dstV, size_t numUVs) {
+	prtu::splitUVs(src, dstU, dstV, numUVs);
+}
+
+// maya arrays store their elements contiguously, the conversions below write directly into the array storage
+static_assert(sizeof(MFloatPoint) == 4 * sizeof(float), "maya float points are expected to be packed xyzw floats");
+static_assert(sizeof(MVector) == 3 * sizeof(double), "maya vectors are expected to be packed xyz doubles");
+
+template <typename T>
+MFloatPointArray toMayaFloatPointArray(T const* a, size_t s) {
 	assert(s % 3 == 0);
 	const unsigned int numPoints = static_cast<unsigned int>(s) / 3;
-	MFloatPointArray mfpa(numPoints);
-	for (unsigned int i = 0; i < numPoints; ++i) {
-		mfpa.set(MFloatPoint(static_cast<float>(a[i * 3 + 0]), static_cast<float>(a[i * 3 + 1]),
-		                     static_cast<float>(a[i * 3 + 2])),
-		         i);
-	}
+	MFloatPointArray mfpa;
+	MCHECK(mfpa.setLength(numPoints));
+	if (numPoints > 0)
+		toMayaPoints(a, &mfpa[0].x, numPoints);
 	return mfpa;
 }
 
+template <typename T>
+void toMayaFloatArrays(T const* uvs, size_t numUVs, MFloatArray& u, MFloatArray& v) {
+	MCHECK(u.setLength(static_cast<unsigned int>(numUVs)));
+	MCHECK(v.setLength(static_cast<unsigned int>(numUVs)));
+	if (numUVs > 0)
+		toMayaUVs(uvs, &u[0], &v[0], numUVs);
+}
+
+// expands the indexed normals to the per face vertex layout of maya (packed xyz doubles)
+template <typename T>
+void expandNormals(T const* nrm, const uint32_t* normalIndices, size_t normalIndicesSize, double* dst) {
+	for (size_t i = 0; i < normalIndicesSize; i++, dst += 3) {
+		const T* n = nrm + 3 * static_cast<size_t>(normalIndices[i]);
+		dst[0] = n[0];
+		dst[1] = n[1];
+		dst[2] = n[2];
+	}
+}
+
+template <typename T>
+MVectorArray toMayaNormals(T const* nrm, const uint32_t* normalIndices, size_t normalIndicesSize) {
+	MVectorArray normals;
+	MCHECK(normals.setLength(static_cast<unsigned int>(normalIndicesSize)));
+	if (normalIndicesSize > 0)
+		expandNormals(nrm, normalIndices, normalIndicesSize, &normals[0].x);
+	return normals;
+}
+
 } // namespace
 
 struct TextureUVOrder {
@@ -98,38 +145,465 @@ const std::vector<TextureUVOrder> TEXTURE_UV_ORDERS = []() -> std::vector<Textur
 	// clang-format on
 }();
 
-void MayaCallbacks::addMesh(const wchar_t*, const double* vtx, size_t vtxSize, const double* nrm, size_t nrmSize,
-                            const uint32_t* faceCounts, size_t faceCountsSize, const uint32_t* vertexIndices,
-                            size_t vertexIndicesSize, const uint32_t* normalIndices,
-                            MAYBE_UNUSED size_t normalIndicesSize, double const* const* uvs, size_t const* uvsSizes,
+// maya arrays of a mesh (converted from prt buffers or accumulated mesh chunks) which are passed to MFnMesh
+struct MayaCallbacks::MayaMesh {
+	struct UVSet {
+		MFloatArray u;
+		MFloatArray v;
+		MIntArray counts;
+		MIntArray indices;
+	};
+
+	MFloatPointArray vertices;
+	MIntArray faceCounts;
+	MIntArray vertexIndices;
+	MVectorArray normals; // per face vertex, empty if there are no normals
+
+	// per prt uv set (nullptr if empty), aliased uv sets share the arrays of their source
+	std::vector<std::shared_ptr<const UVSet>> uvSets;
+
+	uint64_t topologyHash = 0;
+};
+
+// mesh chunks (see IMayaCallbacks::beginMesh) written into the maya arrays of the complete mesh, which are allocated
+// once with the total sizes
+struct MayaCallbacks::MeshChunks {
+	MayaMesh mesh;
+
+	// totals passed to beginMesh
+	size_t numPoints = 0;
+	size_t numFaces = 0;
+	size_t numIndices = 0;
+	std::vector<size_t> numUVs; // per uv set
+	std::vector<size_t> numUVIndices;
+
+	// written so far, the uv set offsets include the chunks in which a uv set is an alias
+	size_t pointsOffset = 0;
+	size_t facesOffset = 0;
+	size_t indicesOffset = 0;
+	std::vector<size_t> uvsOffsets;
+	std::vector<size_t> uvIndicesOffsets;
+
+	bool hasNormals = false;
+
+	// allocated with the first chunk in which a uv set is not an alias (nullptr while aliased or without uvs)
+	std::vector<std::shared_ptr<MayaMesh::UVSet>> uvSets;
+	std::vector<uint32_t> uvSetSources;
+
+	std::vector<uint32_t> faceRanges;
+	AttributeMapVector materials;
+	AttributeMapVector reports;
+	std::vector<int32_t> shapeIDs;
+
+	size_t numChunks = 0;
+
+	// allocates the arrays of a uv set and copies the uvs written so far from its previous source
+	void allocateUVSet(size_t uvSet, uint32_t previousSource) {
+		if (numUVs[uvSet] == 0)
+			return;
+
+		auto uvs = std::make_shared<MayaMesh::UVSet>();
+		MCHECK(uvs->u.setLength(static_cast<unsigned int>(numUVs[uvSet])));
+		MCHECK(uvs->v.setLength(static_cast<unsigned int>(numUVs[uvSet])));
+		MCHECK(uvs->counts.setLength(static_cast<unsigned int>(numFaces)));
+		MCHECK(uvs->indices.setLength(static_cast<unsigned int>(numUVIndices[uvSet])));
+
+		const std::shared_ptr<MayaMesh::UVSet>& source = uvSets[previousSource];
+		if (source) {
+			for (unsigned int i = 0; i < uvsOffsets[uvSet]; i++) {
+				uvs->u[i] = source->u[i];
+				uvs->v[i] = source->v[i];
+			}
+			for (unsigned int i = 0; i < facesOffset; i++)
+				uvs->counts[i] = source->counts[i];
+			for (unsigned int i = 0; i < uvIndicesOffsets[uvSet]; i++)
+				uvs->indices[i] = source->indices[i];
+		}
+		else {
+			for (unsigned int i = 0; i < facesOffset; i++)
+				uvs->counts[i] = 0;
+		}
+		uvSets[uvSet] = uvs;
+	}
+};
+
+namespace {
+
+// normals are locked per face vertex, so a mesh with normals can only be reused by one with normals
+uint64_t computeTopologyHash(const uint32_t* faceCounts, size_t faceCountsSize, const uint32_t* vertexIndices,
+                         size_t vertexIndicesSize, bool hasNormals) {
+	const uint64_t h = prtu::hash(faceCounts, faceCountsSize * sizeof(uint32_t), hasNormals ? 1 : 0);
+	return prtu::hash(vertexIndices, vertexIndicesSize * sizeof(uint32_t), h);
+}
+
+// writes count indices (shifted by base) into a pre-sized maya array, starting at offset
+void copyRebased(const uint32_t* src, size_t count, uint32_t base, MIntArray& dst, size_t offset) {
+	assert(offset + count <= dst.length());
+	if (count == 0)
+		return;
+	uint32_t* tgt = reinterpret_cast<uint32_t*>(&dst[0]) + offset;
+	std::transform(src, src + count, tgt, [base](uint32_t i) { return i + base; });
+}
+
+const uint32_t* getIndices(MIntArray& a) {
+	return (a.length() > 0) ? reinterpret_cast<const uint32_t*>(&a[0]) : nullptr;
+}
+
+} // namespace
+
+MayaCallbacks::MayaCallbacks(const MObject& inMesh, const MObject& outMesh, AttributeMapBuilderUPtr& amb)
+    : inMeshObj(inMesh), outMeshObj(outMesh), mAttributeMapBuilder(amb) {}
+
+MayaCallbacks::~MayaCallbacks() = default;
+
+template <typename T>
+void MayaCallbacks::addMeshImpl(const wchar_t*, const T* vtx, size_t vtxSize, const T* nrm, size_t nrmSize,
+                                const uint32_t* faceCounts, size_t faceCountsSize, const uint32_t* vertexIndices,
+                                size_t vertexIndicesSize, const uint32_t* normalIndices,
+                                MAYBE_UNUSED size_t normalIndicesSize, T const* const* uvs, size_t const* uvsSizes,
+                                uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSetsCount,
+                                const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                                const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                const int32_t* shapeIDs) {
+	MayaMesh mayaMesh;
+	mayaMesh.vertices = toMayaFloatPointArray(vtx, vtxSize);
+	mayaMesh.faceCounts = toMayaIntArray(faceCounts, faceCountsSize);
+	mayaMesh.vertexIndices = toMayaIntArray(vertexIndices, vertexIndicesSize);
+	mayaMesh.topologyHash =
+	        computeTopologyHash(faceCounts, faceCountsSize, vertexIndices, vertexIndicesSize, nrmSize > 0);
+
+	// aliased uv sets (see IMayaCallbacks::addMesh) are converted only once
+	mayaMesh.uvSets.resize(uvSetsCount);
+	for (size_t uvSet = 0; uvSet < uvSetsCount; uvSet++) {
+		const uint32_t source = (uvSetSources != nullptr) ? uvSetSources[uvSet] : static_cast<uint32_t>(uvSet);
+		if (source != uvSet) {
+			mayaMesh.uvSets[uvSet] = mayaMesh.uvSets[source];
+			continue;
+		}
+		if (uvsSizes[uvSet] == 0)
+			continue;
+
+		// maya mesh only supports float uvs
+		auto mayaUVSet = std::make_shared<MayaMesh::UVSet>();
+		toMayaFloatArrays(uvs[uvSet], uvsSizes[uvSet] / 2, mayaUVSet->u, mayaUVSet->v);
+		mayaUVSet->counts = toMayaIntArray(uvCounts[uvSet], uvCountsSizes[uvSet]);
+		mayaUVSet->indices = toMayaIntArray(uvIndices[uvSet], uvIndicesSizes[uvSet]);
+		mayaMesh.uvSets[uvSet] = mayaUVSet;
+	}
+
+	if (nrmSize > 0) {
+		assert(normalIndicesSize == vertexIndicesSize);
+		// guaranteed by MayaEncoder, see prtx::VertexNormalProcessor::SET_MISSING_TO_FACE_NORMALS
+
+		mayaMesh.normals = toMayaNormals(nrm, normalIndices, normalIndicesSize);
+	}
+
+	createMesh(mayaMesh, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void MayaCallbacks::addMesh(size_t, const wchar_t* name, const double* vtx, size_t vtxSize, const double* nrm,
+                            size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                            const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+                            size_t normalIndicesSize, double const* const* uvs, size_t const* uvsSizes,
+                            uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                            uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                            const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                            const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                            const int32_t* shapeIDs) {
+	addMeshImpl(name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize, vertexIndices, vertexIndicesSize,
+	            normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes,
+	            uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void MayaCallbacks::addMesh(size_t, const wchar_t* name, const float* vtx, size_t vtxSize, const float* nrm,
+                            size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                            const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+                            size_t normalIndicesSize, float const* const* uvs, size_t const* uvsSizes,
                             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
-                            uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSetsCount,
-                            const uint32_t* faceRanges, size_t faceRangesSize, const prt::AttributeMap** materials,
-                            const prt::AttributeMap** reports, const int32_t*) {
-	MFloatPointArray mayaVertices = toMayaFloatPointArray(vtx, vtxSize);
-	MIntArray mayaFaceCounts = toMayaIntArray(faceCounts, faceCountsSize);
-	MIntArray mayaVertexIndices = toMayaIntArray(vertexIndices, vertexIndicesSize);
+                            uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                            const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                            const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                            const int32_t* shapeIDs) {
+	addMeshImpl(name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize, vertexIndices, vertexIndicesSize,
+	            normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes,
+	            uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void MayaCallbacks::appendMeshChunk(size_t, const wchar_t* name, const double* vtx, size_t vtxSize, const double* nrm,
+                                    size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                                    const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                    const uint32_t* normalIndices, size_t normalIndicesSize, double const* const* uvs,
+                                    size_t const* uvsSizes, uint32_t const* const* uvCounts,
+                                    size_t const* uvCountsSizes, uint32_t const* const* uvIndices,
+                                    size_t const* uvIndicesSizes, size_t uvSets, const uint32_t* uvSetSources,
+                                    const uint32_t* faceRanges, size_t faceRangesSize,
+                                    const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                    const int32_t* shapeIDs) {
+	appendMeshChunkImpl(name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize, vertexIndices, vertexIndicesSize,
+	                    normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes, uvIndices,
+	                    uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void MayaCallbacks::appendMeshChunk(size_t, const wchar_t* name, const float* vtx, size_t vtxSize, const float* nrm,
+                                    size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                                    const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                    const uint32_t* normalIndices, size_t normalIndicesSize, float const* const* uvs,
+                                    size_t const* uvsSizes, uint32_t const* const* uvCounts,
+                                    size_t const* uvCountsSizes, uint32_t const* const* uvIndices,
+                                    size_t const* uvIndicesSizes, size_t uvSets, const uint32_t* uvSetSources,
+                                    const uint32_t* faceRanges, size_t faceRangesSize,
+                                    const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                    const int32_t* shapeIDs) {
+	appendMeshChunkImpl(name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize, vertexIndices, vertexIndicesSize,
+	                    normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes, uvIndices,
+	                    uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void MayaCallbacks::beginMesh(size_t, const wchar_t*, size_t vtxSize, size_t faceCountsSize, size_t vertexIndicesSize,
+                              size_t const* uvsSizes, size_t const* uvIndicesSizes, size_t uvSets) {
+	mMeshChunks.reset(new MeshChunks());
+	MeshChunks& mc = *mMeshChunks;
+
+	mc.numPoints = vtxSize / 3;
+	mc.numFaces = faceCountsSize;
+	mc.numIndices = vertexIndicesSize;
+	MCHECK(mc.mesh.vertices.setLength(static_cast<unsigned int>(mc.numPoints)));
+	MCHECK(mc.mesh.faceCounts.setLength(static_cast<unsigned int>(mc.numFaces)));
+	MCHECK(mc.mesh.vertexIndices.setLength(static_cast<unsigned int>(mc.numIndices)));
+
+	mc.numUVs.resize(uvSets);
+	mc.numUVIndices.resize(uvSets);
+	for (size_t uvSet = 0; uvSet < uvSets; uvSet++) {
+		mc.numUVs[uvSet] = uvsSizes[uvSet] / 2;
+		mc.numUVIndices[uvSet] = uvIndicesSizes[uvSet];
+	}
+	mc.uvsOffsets.assign(uvSets, 0);
+	mc.uvIndicesOffsets.assign(uvSets, 0);
+	mc.uvSets.resize(uvSets);
+}
+
+template <typename T>
+void MayaCallbacks::appendMeshChunkImpl(const wchar_t*, const T* vtx, size_t vtxSize, const T* nrm, size_t nrmSize,
+                                        const uint32_t* faceCounts, size_t faceCountsSize,
+                                        const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                        const uint32_t* normalIndices, MAYBE_UNUSED size_t normalIndicesSize,
+                                        T const* const* uvs, size_t const* uvsSizes, uint32_t const* const* uvCounts,
+                                        size_t const* uvCountsSizes, uint32_t const* const* uvIndices,
+                                        size_t const* uvIndicesSizes, size_t uvSetsCount,
+                                        const uint32_t* uvSetSources, const uint32_t* faceRanges,
+                                        size_t faceRangesSize, const prt::AttributeMap** materials,
+                                        const prt::AttributeMap** reports, const int32_t* shapeIDs) {
+	if (!mMeshChunks)
+		return; // dropped, see below
+	MeshChunks& mc = *mMeshChunks;
+
+	// the arrays are allocated with the sizes passed to beginMesh, a chunk must not write beyond them
+	const size_t numPoints = vtxSize / 3;
+	bool fits = (uvSetsCount == mc.uvSets.size()) && (mc.pointsOffset + numPoints <= mc.numPoints) &&
+	            (mc.facesOffset + faceCountsSize <= mc.numFaces) &&
+	            (mc.indicesOffset + vertexIndicesSize <= mc.numIndices);
+	for (size_t uvSet = 0; fits && uvSet < uvSetsCount; uvSet++) {
+		fits = (mc.uvsOffsets[uvSet] + uvsSizes[uvSet] / 2 <= mc.numUVs[uvSet]) &&
+		       (mc.uvIndicesOffsets[uvSet] + uvIndicesSizes[uvSet] <= mc.numUVIndices[uvSet]) &&
+		       (uvCountsSizes[uvSet] == faceCountsSize);
+	}
+	if (!fits) {
+		LOG_ERR << "mesh chunk does not match the mesh sizes passed to beginMesh, dropping the mesh";
+		mMeshChunks.reset();
+		return;
+	}
+
+	const uint32_t vertexBase = static_cast<uint32_t>(mc.pointsOffset);
+	const uint32_t faceBase = static_cast<uint32_t>(mc.facesOffset);
+
+	if (numPoints > 0)
+		toMayaPoints(vtx, &mc.mesh.vertices[0].x + 4 * mc.pointsOffset, numPoints);
+	copyRebased(faceCounts, faceCountsSize, 0, mc.mesh.faceCounts, mc.facesOffset);
+	copyRebased(vertexIndices, vertexIndicesSize, vertexBase, mc.mesh.vertexIndices, mc.indicesOffset);
+
+	// normals are kept only if all chunks have them, otherwise maya computes them
+	if (mc.numChunks == 0) {
+		mc.hasNormals = (nrmSize > 0);
+		if (mc.hasNormals)
+			MCHECK(mc.mesh.normals.setLength(static_cast<unsigned int>(mc.numIndices)));
+	}
+	else if (mc.hasNormals && nrmSize == 0) {
+		mc.hasNormals = false;
+		mc.mesh.normals.clear();
+	}
+	if (mc.hasNormals && vertexIndicesSize > 0) {
+		assert(normalIndicesSize == vertexIndicesSize);
+		expandNormals(nrm, normalIndices, vertexIndicesSize, &mc.mesh.normals[0].x + 3 * mc.indicesOffset);
+	}
+
+	// a uv set stays an alias as long as it is one in every chunk, otherwise it gets a copy of its source so far
+	if (mc.numChunks == 0) {
+		mc.uvSetSources.resize(uvSetsCount);
+		for (size_t uvSet = 0; uvSet < uvSetsCount; uvSet++) {
+			mc.uvSetSources[uvSet] = (uvSetSources != nullptr) ? uvSetSources[uvSet] : static_cast<uint32_t>(uvSet);
+			if (mc.uvSetSources[uvSet] == uvSet)
+				mc.allocateUVSet(uvSet, mc.uvSetSources[uvSet]);
+		}
+	}
+	for (size_t uvSet = 0; uvSet < uvSetsCount; uvSet++) {
+		const uint32_t source = mc.uvSetSources[uvSet];
+		if (source != uvSet && (uvSetSources == nullptr || uvSetSources[uvSet] != uvSetSources[source])) {
+			mc.allocateUVSet(uvSet, source);
+			mc.uvSetSources[uvSet] = static_cast<uint32_t>(uvSet);
+		}
+	}
+
+	// the arrays of aliases in this chunk point to their source, so they can be written alike
+	for (size_t uvSet = 0; uvSet < uvSetsCount; uvSet++) {
+		const size_t numUVs = uvsSizes[uvSet] / 2;
+		const size_t uvsOffset = mc.uvsOffsets[uvSet];
+		const size_t uvIndicesOffset = mc.uvIndicesOffsets[uvSet];
+		mc.uvsOffsets[uvSet] += numUVs;
+		mc.uvIndicesOffsets[uvSet] += uvIndicesSizes[uvSet];
+
+		const std::shared_ptr<MayaMesh::UVSet>& mayaUVSet = mc.uvSets[uvSet];
+		if (mc.uvSetSources[uvSet] != uvSet || !mayaUVSet)
+			continue;
+
+		if (numUVs > 0)
+			toMayaUVs(uvs[uvSet], &mayaUVSet->u[0] + uvsOffset, &mayaUVSet->v[0] + uvsOffset, numUVs);
+		copyRebased(uvCounts[uvSet], uvCountsSizes[uvSet], 0, mayaUVSet->counts, mc.facesOffset);
+		copyRebased(uvIndices[uvSet], uvIndicesSizes[uvSet], static_cast<uint32_t>(uvsOffset), mayaUVSet->indices,
+		            uvIndicesOffset);
+	}
+
+	mc.pointsOffset += numPoints;
+	mc.facesOffset += faceCountsSize;
+	mc.indicesOffset += vertexIndicesSize;
+
+	// the closing face range is added in endMesh
+	for (size_t fri = 0; fri + 1 < faceRangesSize; fri++) {
+		mc.faceRanges.push_back(faceBase + faceRanges[fri]);
+
+		// the encoder destroys the materials and reports after this call
+		if (materials != nullptr) {
+			AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(materials[fri]));
+			mc.materials.emplace_back(amb->createAttributeMap());
+		}
+		if (reports != nullptr) {
+			AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(reports[fri]));
+			mc.reports.emplace_back(amb->createAttributeMap());
+		}
+		if (shapeIDs != nullptr)
+			mc.shapeIDs.push_back(shapeIDs[fri]);
+	}
+
+	mc.numChunks++;
+}
+
+void MayaCallbacks::endMesh(size_t, const wchar_t*) {
+	if (!mMeshChunks)
+		return;
+	const std::unique_ptr<MeshChunks> mc = std::move(mMeshChunks);
+
+	if (DBG)
+		LOG_DBG << "-- MayaCallbacks::endMesh: numChunks = " << mc->numChunks;
+
+	// the chunks must fill the arrays which have been allocated with the sizes passed to beginMesh
+	bool complete = (mc->pointsOffset == mc->numPoints) && (mc->facesOffset == mc->numFaces) &&
+	                (mc->indicesOffset == mc->numIndices);
+	for (size_t uvSet = 0; complete && uvSet < mc->uvSets.size(); uvSet++) {
+		complete = (mc->uvsOffsets[uvSet] == mc->numUVs[uvSet]) &&
+		           (mc->uvIndicesOffsets[uvSet] == mc->numUVIndices[uvSet]);
+	}
+	if (!complete) {
+		LOG_ERR << "mesh chunks do not match the mesh sizes passed to beginMesh, dropping the mesh";
+		return;
+	}
+
+	MayaMesh& mayaMesh = mc->mesh;
+	mayaMesh.topologyHash =
+	        computeTopologyHash(getIndices(mayaMesh.faceCounts), mayaMesh.faceCounts.length(),
+	                            getIndices(mayaMesh.vertexIndices), mayaMesh.vertexIndices.length(), mc->hasNormals);
+
+	mayaMesh.uvSets.resize(mc->uvSets.size());
+	for (size_t uvSet = 0; uvSet < mc->uvSets.size(); uvSet++) {
+		const uint32_t source = mc->uvSetSources.empty() ? static_cast<uint32_t>(uvSet) : mc->uvSetSources[uvSet];
+		if (source != uvSet)
+			mayaMesh.uvSets[uvSet] = mayaMesh.uvSets[source];
+		else
+			mayaMesh.uvSets[uvSet] = mc->uvSets[uvSet];
+	}
+
+	mc->faceRanges.push_back(static_cast<uint32_t>(mc->facesOffset)); // close last range
+
+	const auto toPtrs = [](const AttributeMapVector& maps) {
+		std::vector<const prt::AttributeMap*> ptrs;
+		ptrs.reserve(maps.size());
+		for (const AttributeMapUPtr& m : maps)
+			ptrs.push_back(m.get());
+		return ptrs;
+	};
+	std::vector<const prt::AttributeMap*> materials = toPtrs(mc->materials);
+	std::vector<const prt::AttributeMap*> reports = toPtrs(mc->reports);
+	assert(materials.empty() || materials.size() == mc->faceRanges.size() - 1);
+	assert(reports.empty() || reports.size() == mc->faceRanges.size() - 1);
+	assert(mc->shapeIDs.empty() || mc->shapeIDs.size() == mc->faceRanges.size() - 1);
+
+	createMesh(mayaMesh, mc->faceRanges.data(), mc->faceRanges.size(), materials.empty() ? nullptr : materials.data(),
+	           reports.empty() ? nullptr : reports.data(), mc->shapeIDs.empty() ? nullptr : mc->shapeIDs.data());
+}
+
+void MayaCallbacks::createMesh(MayaMesh& mayaMesh, const uint32_t* faceRanges, size_t faceRangesSize,
+                               const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                               const int32_t*) {
+	const MFloatPointArray& mayaVertices = mayaMesh.vertices;
+	const MIntArray& mayaFaceCounts = mayaMesh.faceCounts;
 
 	if (DBG) {
-		LOG_DBG << "-- MayaCallbacks::addMesh";
-		LOG_DBG << "   faceCountsSize = " << faceCountsSize;
-		LOG_DBG << "   vertexIndicesSize = " << vertexIndicesSize;
+		LOG_DBG << "-- MayaCallbacks::createMesh";
 		LOG_DBG << "   mayaVertices.length         = " << mayaVertices.length();
 		LOG_DBG << "   mayaFaceCounts.length   = " << mayaFaceCounts.length();
-		LOG_DBG << "   mayaVertexIndices.length = " << mayaVertexIndices.length();
+		LOG_DBG << "   mayaVertexIndices.length = " << mayaMesh.vertexIndices.length();
 	}
 
 	MStatus stat;
 	MCHECK(stat);
 
-	MFnMeshData dataCreator;
-	MObject newOutputData = dataCreator.create(&stat);
-	MCHECK(stat);
+	mTopologyHash = mayaMesh.topologyHash;
+
+	// fast path: the connectivity did not change, just move the vertices of the previous mesh
+	bool reuseMesh = false;
+	if (!mReusableMesh.isNull() && mReusableTopologyHash == mTopologyHash) {
+		MFnMesh reusableMesh(mReusableMesh, &stat);
+		reuseMesh = (stat == MS::kSuccess) && (reusableMesh.numVertices() == static_cast<int>(mayaVertices.length()));
+		if (reuseMesh) {
+			MCHECK(reusableMesh.setPoints(mayaVertices));
+			if (DBG)
+				LOG_DBG << "   topology unchanged, updated vertex positions only";
+		}
+	}
 
-	MFnMesh mFnMesh1;
-	MObject oMesh = mFnMesh1.create(mayaVertices.length(), mayaFaceCounts.length(), mayaVertices, mayaFaceCounts,
-	                                mayaVertexIndices, newOutputData, &stat);
-	MCHECK(stat);
+	// otherwise build directly into the output mesh data if we have one (serlio node, new mesh data is created for a
+	// null outMesh), only a mesh shape (serlio command) needs the detour via a temporary mesh which is then copied over
+	if (!reuseMesh && outMeshObj.isNull()) {
+		MFnMeshData dataCreator;
+		outMeshObj = dataCreator.create(&stat);
+		MCHECK(stat);
+	}
+	const bool buildInPlace = outMeshObj.hasFn(MFn::kMeshData);
+	MObject oMesh = mReusableMesh;
+	if (!reuseMesh) {
+		MObject meshParent = outMeshObj;
+		if (!buildInPlace) {
+			MFnMeshData dataCreator;
+			meshParent = dataCreator.create(&stat);
+			MCHECK(stat);
+		}
+
+		MFnMesh mFnMesh1;
+		oMesh = mFnMesh1.create(mayaVertices.length(), mayaFaceCounts.length(), mayaVertices, mayaFaceCounts,
+		                        mayaMesh.vertexIndices, meshParent, &stat);
+		MCHECK(stat);
+	}
+	mHasOutputMesh = true;
+	mReusedMesh = reuseMesh;
 
 	MFnMesh mFnMesh(oMesh);
 	mFnMesh.clearUVs();
@@ -138,30 +612,24 @@ void MayaCallbacks::addMesh(const wchar_t*, const double* vtx, size_t vtxSize, c
 	for (const TextureUVOrder& o : TEXTURE_UV_ORDERS) {
 		uint8_t uvSet = o.prtUvSetIndex;
 
-		if (uvSetsCount > uvSet && uvsSizes[uvSet] > 0) {
-
-			MFloatArray mU;
-			MFloatArray mV;
-			for (size_t uvIdx = 0; uvIdx < uvsSizes[uvSet] / 2; ++uvIdx) {
-				mU.append(static_cast<float>(uvs[uvSet][uvIdx * 2 + 0])); // maya mesh only supports float uvs
-				mV.append(static_cast<float>(uvs[uvSet][uvIdx * 2 + 1]));
-			}
+		// a reused mesh already has all uv sets (see below), but they might hold outdated uvs
+		if (reuseMesh && uvSet != 0)
+			MCHECK(mFnMesh.clearUVs(&o.mayaUvSetName));
 
+		if (mayaMesh.uvSets.size() > uvSet && mayaMesh.uvSets[uvSet]) {
 			MString uvSetName = o.mayaUvSetName;
 
-			if (uvSet != 0) {
+			if (uvSet != 0 && !reuseMesh) {
 				mFnMesh.createUVSetDataMeshWithName(uvSetName, &stat);
 				MCHECK(stat);
 			}
 
-			MCHECK(mFnMesh.setUVs(mU, mV, &uvSetName));
-
-			MIntArray mUVCounts = toMayaIntArray(uvCounts[uvSet], uvCountsSizes[uvSet]);
-			MIntArray mUVIndices = toMayaIntArray(uvIndices[uvSet], uvIndicesSizes[uvSet]);
-			MCHECK(mFnMesh.assignUVs(mUVCounts, mUVIndices, &uvSetName));
+			const MayaMesh::UVSet& mayaUVSet = *mayaMesh.uvSets[uvSet];
+			MCHECK(mFnMesh.setUVs(mayaUVSet.u, mayaUVSet.v, &uvSetName));
+			MCHECK(mFnMesh.assignUVs(mayaUVSet.counts, mayaUVSet.indices, &uvSetName));
 		}
 		else {
-			if (uvSet > 0) {
+			if (uvSet > 0 && !reuseMesh) {
 				// add empty set to keep order consistent
 				mFnMesh.createUVSetDataMeshWithName(o.mayaUvSetName, &stat);
 				MCHECK(stat);
@@ -169,31 +637,23 @@ void MayaCallbacks::addMesh(const wchar_t*, const double* vtx, size_t vtxSize, c
 		}
 	}
 
-	if (nrmSize > 0) {
-		assert(normalIndicesSize == vertexIndicesSize);
-		// guaranteed by MayaEncoder, see prtx::VertexNormalProcessor::SET_MISSING_TO_FACE_NORMALS
+	if (mayaMesh.normals.length() > 0) {
+		assert(mayaMesh.normals.length() == mayaMesh.vertexIndices.length());
+		MIntArray faceList(mayaMesh.normals.length());
 
-		// convert to native maya normal layout
-		MVectorArray expandedNormals(static_cast<unsigned int>(vertexIndicesSize));
-		MIntArray faceList(static_cast<unsigned int>(vertexIndicesSize));
-
-		int indexCount = 0;
-		for (int i = 0; i < faceCountsSize; i++) {
-			int faceLength = mayaFaceCounts[i];
-
-			for (int j = 0; j < faceLength; j++) {
-				faceList[indexCount] = i;
-				int idx = normalIndices[indexCount];
-				expandedNormals.set(&nrm[idx * 3], indexCount);
-				indexCount++;
-			}
+		unsigned int indexCount = 0;
+		for (unsigned int i = 0; i < mayaFaceCounts.length(); i++) {
+			const int faceLength = mayaFaceCounts[i];
+			for (int j = 0; j < faceLength; j++)
+				faceList[indexCount++] = static_cast<int>(i);
 		}
 
-		MCHECK(mFnMesh.setFaceVertexNormals(expandedNormals, faceList, mayaVertexIndices));
+		MCHECK(mFnMesh.setFaceVertexNormals(mayaMesh.normals, faceList, mayaMesh.vertexIndices));
 	}
 
-	MFnMesh outputMesh(outMeshObj);
-	outputMesh.copyInPlace(oMesh);
+	MFnMesh outputMesh(reuseMesh ? mReusableMesh : outMeshObj);
+	if (!reuseMesh && !buildInPlace)
+		outputMesh.copyInPlace(oMesh);
 
 	// create material metadata
 	constexpr unsigned int maxStringLength = 400;
@@ -35,8 +35,8 @@
 
 class MayaCallbacks : public IMayaCallbacks {
 public:
-	MayaCallbacks(const MObject& inMesh, const MObject& outMesh, AttributeMapBuilderUPtr& amb)
-	    : inMeshObj(inMesh), outMeshObj(outMesh), mAttributeMapBuilder(amb) {}
+	MayaCallbacks(const MObject& inMesh, const MObject& outMesh, AttributeMapBuilderUPtr& amb);
+	~MayaCallbacks() override;
 
 	// prt::Callbacks interface
 	prt::Status generateError(size_t /*isIndex*/, prt::Status /*status*/, const wchar_t* message) override {
@@ -88,7 +88,7 @@ public:
 
 public:
 	// clang-format off
-	void addMesh(const wchar_t* name,
+	void addMesh(size_t isIndex, const wchar_t* name,
 	                     const double* vtx, size_t vtxSize,
 	                     const double* nrm, size_t nrmSize,
 	                     const uint32_t* faceCounts, size_t faceCountsSize,
@@ -98,17 +98,146 @@ public:
 	                     double const* const* uvs, size_t const* uvsSizes,
 	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
 	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
-	                     size_t uvSets,
+	                     size_t uvSets, const uint32_t* uvSetSources,
 
 	                     const uint32_t* faceRanges, size_t faceRangesSize,
 	                     const prt::AttributeMap** materials,
 	                     const prt::AttributeMap** reports,
 	                     const int32_t* shapeIDs) override;
+	void addMesh(size_t isIndex, const wchar_t* name,
+	             const float* vtx, size_t vtxSize,
+	             const float* nrm, size_t nrmSize,
+	             const uint32_t* faceCounts, size_t faceCountsSize,
+	             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	             float const* const* uvs, size_t const* uvsSizes,
+	             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	             size_t uvSets, const uint32_t* uvSetSources,
+
+	             const uint32_t* faceRanges, size_t faceRangesSize,
+	             const prt::AttributeMap** materials,
+	             const prt::AttributeMap** reports,
+	             const int32_t* shapeIDs) override;
+
+	// streamed meshes are written into maya arrays allocated with the sizes passed to beginMesh, the maya mesh is
+	// created on endMesh
+	void beginMesh(size_t isIndex, const wchar_t* name, size_t vtxSize, size_t faceCountsSize,
+	               size_t vertexIndicesSize, size_t const* uvsSizes, size_t const* uvIndicesSizes,
+	               size_t uvSets) override;
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const double* vtx, size_t vtxSize,
+	                     const double* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     double const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override;
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const float* vtx, size_t vtxSize,
+	                     const float* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     float const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override;
+	void endMesh(size_t isIndex, const wchar_t* name) override;
 	// clang-format on
 
+	// true if addMesh has been called, i.e. outMesh (or the reusable mesh) holds generated geometry
+	bool hasOutputMesh() const {
+		return mHasOutputMesh;
+	}
+
+	// a previously generated mesh with the given topology hash: if the new mesh has the same face counts and vertex
+	// indices, addMesh only updates its vertex positions, uvs and normals instead of writing into outMesh
+	void setReusableMesh(const MObject& mesh, uint64_t topologyHash) {
+		mReusableMesh = mesh;
+		mReusableTopologyHash = topologyHash;
+	}
+	bool hasReusedMesh() const {
+		return mReusedMesh;
+	}
+	// the mesh which holds the generated geometry: the reused mesh, outMesh or the mesh data created for a null outMesh
+	const MObject& getOutputMesh() const {
+		return mReusedMesh ? mReusableMesh : outMeshObj;
+	}
+	uint64_t getTopologyHash() const {
+		return mTopologyHash;
+	}
+
 private:
+	struct MayaMesh;
+	struct MeshChunks;
+
+	// the double and float variants of addMesh and appendMeshChunk only differ in the conversion of the vertex data
+	// clang-format off
+	template <typename T>
+	void addMeshImpl(const wchar_t* name,
+	                 const T* vtx, size_t vtxSize,
+	                 const T* nrm, size_t nrmSize,
+	                 const uint32_t* faceCounts, size_t faceCountsSize,
+	                 const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                 const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                 T const* const* uvs, size_t const* uvsSizes,
+	                 uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                 uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                 size_t uvSets, const uint32_t* uvSetSources,
+
+	                 const uint32_t* faceRanges, size_t faceRangesSize,
+	                 const prt::AttributeMap** materials,
+	                 const prt::AttributeMap** reports,
+	                 const int32_t* shapeIDs);
+	template <typename T>
+	void appendMeshChunkImpl(const wchar_t* name,
+	                         const T* vtx, size_t vtxSize,
+	                         const T* nrm, size_t nrmSize,
+	                         const uint32_t* faceCounts, size_t faceCountsSize,
+	                         const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                         const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                         T const* const* uvs, size_t const* uvsSizes,
+	                         uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                         uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                         size_t uvSets, const uint32_t* uvSetSources,
+
+	                         const uint32_t* faceRanges, size_t faceRangesSize,
+	                         const prt::AttributeMap** materials,
+	                         const prt::AttributeMap** reports,
+	                         const int32_t* shapeIDs);
+	// clang-format on
+
+	void createMesh(MayaMesh& mayaMesh, const uint32_t* faceRanges, size_t faceRangesSize,
+	                const prt::AttributeMap** materials, const prt::AttributeMap** reports, const int32_t* shapeIDs);
+
 	MObject outMeshObj;
 	MObject inMeshObj;
+	bool mHasOutputMesh = false;
+
+	MObject mReusableMesh;
+	uint64_t mReusableTopologyHash = 0;
+	uint64_t mTopologyHash = 0;
+	bool mReusedMesh = false;
+
+	std::unique_ptr<MeshChunks> mMeshChunks;
 
 	AttributeMapBuilderUPtr& mAttributeMapBuilder;
 };
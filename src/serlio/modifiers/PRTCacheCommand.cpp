@@ -0,0 +1,86 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/PRTCacheCommand.h"
+#include "modifiers/PRTModifierAction.h"
+
+#include "PRTContext.h"
+
+#include "utils/DefaultAttributeValuesCache.h"
+#include "utils/LogHandler.h"
+
+#include "maya/MArgDatabase.h"
+#include "maya/MString.h"
+
+#include <sstream>
+
+namespace {
+
+constexpr const char* FLAG_FLUSH = "-f";
+constexpr const char* FLAG_FLUSH_LONG = "-flush";
+constexpr const char* FLAG_STATS = "-s";
+constexpr const char* FLAG_STATS_LONG = "-stats";
+
+constexpr uint64_t MB = 1 << 20;
+
+} // namespace
+
+MSyntax PRTCacheCommand::createSyntax() {
+	MSyntax syntax;
+	syntax.addFlag(FLAG_FLUSH, FLAG_FLUSH_LONG);
+	syntax.addFlag(FLAG_STATS, FLAG_STATS_LONG);
+	return syntax;
+}
+
+MStatus PRTCacheCommand::doIt(const MArgList& argList) {
+	MStatus status;
+	MArgDatabase args(syntax(), argList, &status);
+	if (status != MS::kSuccess)
+		return status;
+
+	PRTContext& prtCtx = PRTContext::get();
+	if (!prtCtx.isAlive()) {
+		displayError("PRT is not initialized");
+		return MS::kFailure;
+	}
+
+	if (args.isFlagSet(FLAG_FLUSH)) {
+		const uint64_t before = prtu::getProcessResidentMemory();
+		prtCtx.theCache->flushAll();
+		const uint64_t after = prtu::getProcessResidentMemory();
+		LOG_INF << "flushed PRT cache, resident memory " << before / MB << "MB -> " << after / MB << "MB";
+	}
+
+	// PRT does not report the size of its cache, the resident memory of the process serves as a proxy
+	if (args.isFlagSet(FLAG_STATS)) {
+		const ResolveMapCache::Stats rpkStats = prtCtx.mResolveMapCache->getStats();
+		const DefaultAttributeValuesCache& defaultValuesCache = *prtCtx.mDefaultAttributeValuesCache;
+		std::ostringstream stats;
+		stats << "residentMemoryMB=" << prtu::getProcessResidentMemory() / MB << " rpkCacheEntries=" << rpkStats.entries
+		      << " rpkCacheUnpackedMB=" << rpkStats.unpackedBytes / MB << " rpkCacheHits=" << rpkStats.hits
+		      << " rpkCacheMisses=" << rpkStats.misses << " rpkCacheEvictions=" << rpkStats.evictions
+		      << " defaultValuesCacheEntries=" << defaultValuesCache.size()
+		      << " defaultValuesCacheHits=" << defaultValuesCache.getHitCount()
+		      << " defaultValuesCacheMisses=" << defaultValuesCache.getMissCount()
+		      << " canceledGenerates=" << PRTModifierAction::getCanceledGenerateCount();
+		setResult(MString(stats.str().c_str()));
+	}
+
+	return MS::kSuccess;
+}
@@ -0,0 +1,364 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/PRTGenerateAllCommand.h"
+#include "modifiers/MayaCallbacks.h"
+#include "modifiers/PRTModifierNode.h"
+#include "modifiers/RecordingCallbacks.h"
+
+#include "utils/LogHandler.h"
+#include "utils/MItDependencyNodesWrapper.h"
+#include "utils/MayaUtilities.h"
+#include "utils/Utilities.h"
+
+#include "maya/MFnDependencyNode.h"
+#include "maya/MFnMesh.h"
+#include "maya/MFnMeshData.h"
+#include "maya/MGlobal.h"
+#include "maya/MItDependencyNodes.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr bool DBG = false;
+
+// forwards the callbacks of a batched generate call to the callbacks of the corresponding initial shape. The meshes
+// are recorded, because the encoders run on the PRT worker threads and the maya API must only be used on the main
+// thread. itemIndices maps the initial shape index of the generate call to the index of the callbacks.
+class BatchCallbacks : public IMayaCallbacks {
+public:
+	BatchCallbacks(std::vector<std::unique_ptr<MayaCallbacks>>& callbacks,
+	               std::vector<std::unique_ptr<RecordingCallbacks>>& recordings, const std::vector<size_t>& itemIndices)
+	    : mCallbacks(callbacks), mRecordings(recordings), mItemIndices(itemIndices) {}
+
+	// prt::Callbacks interface
+	prt::Status generateError(size_t isIndex, prt::Status status, const wchar_t* message) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).generateError(isIndex, status, message);
+	}
+	prt::Status assetError(size_t isIndex, prt::CGAErrorLevel level, const wchar_t* key, const wchar_t* uri,
+	                       const wchar_t* message) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).assetError(isIndex, level, key, uri, message);
+	}
+	prt::Status cgaError(size_t isIndex, int32_t shapeID, prt::CGAErrorLevel level, int32_t methodId, int32_t pc,
+	                     const wchar_t* message) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).cgaError(isIndex, shapeID, level, methodId, pc, message);
+	}
+	prt::Status cgaPrint(size_t isIndex, int32_t shapeID, const wchar_t* txt) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).cgaPrint(isIndex, shapeID, txt);
+	}
+	prt::Status cgaReportBool(size_t isIndex, int32_t shapeID, const wchar_t* key, bool value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).cgaReportBool(isIndex, shapeID, key, value);
+	}
+	prt::Status cgaReportFloat(size_t isIndex, int32_t shapeID, const wchar_t* key, double value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).cgaReportFloat(isIndex, shapeID, key, value);
+	}
+	prt::Status cgaReportString(size_t isIndex, int32_t shapeID, const wchar_t* key, const wchar_t* value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).cgaReportString(isIndex, shapeID, key, value);
+	}
+	prt::Status attrBool(size_t isIndex, int32_t shapeID, const wchar_t* key, bool value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrBool(isIndex, shapeID, key, value);
+	}
+	prt::Status attrFloat(size_t isIndex, int32_t shapeID, const wchar_t* key, double value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrFloat(isIndex, shapeID, key, value);
+	}
+	prt::Status attrString(size_t isIndex, int32_t shapeID, const wchar_t* key, const wchar_t* value) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrString(isIndex, shapeID, key, value);
+	}
+
+// PRT version >= 2.1
+#if PRT_VERSION_GTE(2, 1)
+
+	prt::Status attrBoolArray(size_t isIndex, int32_t shapeID, const wchar_t* key, const bool* values,
+	                          size_t size) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrBoolArray(isIndex, shapeID, key, values, size);
+	}
+	prt::Status attrFloatArray(size_t isIndex, int32_t shapeID, const wchar_t* key, const double* values,
+	                           size_t size) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrFloatArray(isIndex, shapeID, key, values, size);
+	}
+	prt::Status attrStringArray(size_t isIndex, int32_t shapeID, const wchar_t* key, const wchar_t* const* values,
+	                            size_t size) override {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return get(isIndex).attrStringArray(isIndex, shapeID, key, values, size);
+	}
+
+#endif // PRT version >= 2.1
+
+	// clang-format off
+	void addMesh(size_t isIndex, const wchar_t* name,
+	             const double* vtx, size_t vtxSize,
+	             const double* nrm, size_t nrmSize,
+	             const uint32_t* faceCounts, size_t faceCountsSize,
+	             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	             double const* const* uvs, size_t const* uvsSizes,
+	             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	             size_t uvSets, const uint32_t* uvSetSources,
+
+	             const uint32_t* faceRanges, size_t faceRangesSize,
+	             const prt::AttributeMap** materials,
+	             const prt::AttributeMap** reports,
+	             const int32_t* shapeIDs) override {
+		// clang-format on
+		getRecording(isIndex).addMesh(isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+		                              vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes,
+		                              uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes, uvSets, uvSetSources,
+		                              faceRanges, faceRangesSize, materials, reports, shapeIDs);
+	}
+
+	// clang-format off
+	void addMesh(size_t isIndex, const wchar_t* name,
+	             const float* vtx, size_t vtxSize,
+	             const float* nrm, size_t nrmSize,
+	             const uint32_t* faceCounts, size_t faceCountsSize,
+	             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	             float const* const* uvs, size_t const* uvsSizes,
+	             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	             size_t uvSets, const uint32_t* uvSetSources,
+
+	             const uint32_t* faceRanges, size_t faceRangesSize,
+	             const prt::AttributeMap** materials,
+	             const prt::AttributeMap** reports,
+	             const int32_t* shapeIDs) override {
+		// clang-format on
+		getRecording(isIndex).addMesh(isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+		                              vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes,
+		                              uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes, uvSets, uvSetSources,
+		                              faceRanges, faceRangesSize, materials, reports, shapeIDs);
+	}
+
+	void beginMesh(size_t isIndex, const wchar_t* name, size_t vtxSize, size_t faceCountsSize,
+	               size_t vertexIndicesSize, size_t const* uvsSizes, size_t const* uvIndicesSizes,
+	               size_t uvSets) override {
+		getRecording(isIndex).beginMesh(isIndex, name, vtxSize, faceCountsSize, vertexIndicesSize, uvsSizes,
+		                                uvIndicesSizes, uvSets);
+	}
+
+	// clang-format off
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const double* vtx, size_t vtxSize,
+	                     const double* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     double const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override {
+		// clang-format on
+		getRecording(isIndex).appendMeshChunk(isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+		                                      vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs,
+		                                      uvsSizes, uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes, uvSets,
+		                                      uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+	}
+
+	// clang-format off
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const float* vtx, size_t vtxSize,
+	                     const float* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     float const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override {
+		// clang-format on
+		getRecording(isIndex).appendMeshChunk(isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+		                                      vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs,
+		                                      uvsSizes, uvCounts, uvCountsSizes, uvIndices, uvIndicesSizes, uvSets,
+		                                      uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+	}
+
+	void endMesh(size_t isIndex, const wchar_t* name) override {
+		getRecording(isIndex).endMesh(isIndex, name);
+	}
+
+private:
+	MayaCallbacks& get(size_t isIndex) {
+		return *mCallbacks.at(mItemIndices.at(isIndex));
+	}
+
+	// an initial shape is encoded by a single thread, so its recording needs no locking
+	RecordingCallbacks& getRecording(size_t isIndex) {
+		return *mRecordings.at(mItemIndices.at(isIndex));
+	}
+
+	std::vector<std::unique_ptr<MayaCallbacks>>& mCallbacks;
+	std::vector<std::unique_ptr<RecordingCallbacks>>& mRecordings;
+	const std::vector<size_t>& mItemIndices;
+	std::mutex mMutex;
+};
+
+struct BatchItem {
+	PRTModifierNode* node = nullptr;
+	MString nodeName;
+	MObject outMeshData;
+	AttributeMapBuilderUPtr attributeBuilder;
+	bool failed = false;
+};
+
+// the items which are generated with the same encoders and encoder options, i.e. in the same prt::generate call
+struct BatchGroup {
+	std::vector<const wchar_t*> encIDs;
+	AttributeMapNOPtrVector encOpts;
+	std::vector<size_t> itemIndices;
+};
+
+// the single pass attribute evaluation is not done in batch mode
+std::string getEncodersKey(const PRTModifierAction& action, std::vector<const wchar_t*>& encIDs,
+                           AttributeMapNOPtrVector& encOpts) {
+	action.getEncoders(encIDs, encOpts, false);
+	std::string key;
+	for (size_t i = 0; i < encIDs.size(); i++)
+		key += prtu::toOSNarrowFromUTF16(encIDs[i]) + prtu::objectToXML(encOpts[i]);
+	return key;
+}
+
+} // namespace
+
+MStatus PRTGenerateAllCommand::doIt(const MArgList&) {
+	MStatus status;
+
+	std::vector<BatchItem> items;
+	std::vector<std::unique_ptr<MayaCallbacks>> callbacks;
+	std::vector<std::unique_ptr<RecordingCallbacks>> recordings;
+	std::vector<InitialShapeUPtr> shapes;
+	std::map<std::string, BatchGroup> groups;
+
+	MItDependencyNodes nodeIt(MFn::kPluginDependNode, &status);
+	MCHECK(status);
+	for (const auto& nodeObj : MItDependencyNodesWrapper(nodeIt)) {
+		MFnDependencyNode fNode(nodeObj);
+		if (fNode.typeId() != PRTModifierNode::id)
+			continue;
+
+		auto* node = static_cast<PRTModifierNode*>(fNode.userNode());
+		PRTModifierAction* action = node->prepareBatchGenerate();
+		if (action == nullptr) {
+			if (DBG)
+				LOG_DBG << "skipping node " << fNode.name().asWChar();
+			continue;
+		}
+
+		// generate into new mesh data, like compute does
+		MFnMeshData dataCreator;
+		MObject outMeshData = dataCreator.create(&status);
+		MCHECK(status);
+
+		BatchItem item;
+		item.node = node;
+		item.nodeName = fNode.name();
+		item.outMeshData = outMeshData;
+		item.attributeBuilder.reset(prt::AttributeMapBuilder::create());
+
+		// group the items by their encoder options, one generate call is needed per group
+		std::vector<const wchar_t*> encIDs;
+		AttributeMapNOPtrVector encOpts;
+		BatchGroup& group = groups[getEncodersKey(*action, encIDs, encOpts)];
+		if (group.itemIndices.empty()) {
+			group.encIDs = encIDs;
+			group.encOpts = encOpts;
+		}
+		group.itemIndices.push_back(items.size());
+
+		callbacks.emplace_back(new MayaCallbacks(action->getInMesh(), item.outMeshData, item.attributeBuilder));
+		recordings.emplace_back(new RecordingCallbacks());
+		shapes.emplace_back(action->createInitialShape());
+		items.emplace_back(std::move(item));
+	}
+
+	if (shapes.empty()) {
+		setResult(0);
+		return MS::kSuccess;
+	}
+
+	size_t failedCount = 0;
+	for (const auto& g : groups) {
+		const BatchGroup& group = g.second;
+
+		InitialShapeNOPtrVector shapePtrs;
+		shapePtrs.reserve(group.itemIndices.size());
+		for (const size_t i : group.itemIndices)
+			shapePtrs.push_back(shapes[i].get());
+
+		BatchCallbacks batchCallbacks(callbacks, recordings, group.itemIndices);
+		const prt::Status generateStatus = prt::generate(
+		        shapePtrs.data(), shapePtrs.size(), nullptr, group.encIDs.data(), group.encIDs.size(),
+		        group.encOpts.data(), &batchCallbacks, PRTContext::get().theCache.get(), nullptr);
+		if (generateStatus != prt::STATUS_OK) {
+			LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+			for (const size_t i : group.itemIndices)
+				items[i].failed = true;
+			failedCount += group.itemIndices.size();
+		}
+	}
+
+	// create the meshes on the main thread, hand over the results and let maya pull them through the regular compute.
+	// the items of a failed generate call get the input mesh, the partial results are discarded.
+	for (size_t i = 0; i < items.size(); i++) {
+		BatchItem& item = items[i];
+		if (!item.failed)
+			recordings[i]->replay(*callbacks[i]);
+		recordings[i].reset();
+		if (item.failed || !callbacks[i]->hasOutputMesh()) { // pass through the input mesh
+			MFnMesh().copy(item.node->fPRTModifierAction.getInMesh(), item.outMeshData, &status);
+			MCHECK(status);
+		}
+		item.node->setBatchResult(item.outMeshData, item.node->fPRTModifierAction.getGenerateSignature());
+		MCHECK(MGlobal::executeCommand("dgdirty " + item.nodeName + ".outMesh"));
+	}
+
+	LOG_INF << "generated " << items.size() - failedCount << " serlio nodes in " << groups.size() << " batch(es)";
+	setResult(static_cast<int>(items.size() - failedCount));
+	return (failedCount == 0) ? MS::kSuccess : MS::kFailure;
+}
@@ -19,10 +19,9 @@
 
 #include "modifiers/PRTMesh.h"
 
-#include "utils/MArrayWrapper.h"
 #include "utils/MayaUtilities.h"
+#include "utils/Utilities.h"
 
-#include "maya/MFloatPointArray.h"
 #include "maya/MFnMesh.h"
 #include "maya/MIntArray.h"
 
@@ -35,28 +34,29 @@ PRTMesh::PRTMesh(const MObject& mesh) {
 	const MFnMesh meshFn(mesh, &status);
 	MCHECK(status);
 
-	// vertex coordinates
-	MFloatPointArray vertexArray;
-	meshFn.getPoints(vertexArray);
-
-	const unsigned int vertexArrayLength = vertexArray.length();
-	mVertexCoordsVec.reserve(3 * vertexArrayLength);
-	for (unsigned int i = 0; i < vertexArrayLength; ++i) {
-		mVertexCoordsVec.push_back(vertexArray[i].x);
-		mVertexCoordsVec.push_back(vertexArray[i].y);
-		mVertexCoordsVec.push_back(vertexArray[i].z);
-	}
+	// vertex coordinates: read the packed xyz floats directly (no intermediate MFloatPointArray)
+	const size_t numCoords = 3 * static_cast<size_t>(meshFn.numVertices());
+	const float* rawPoints = meshFn.getRawPoints(&status);
+	MCHECK(status);
+	mVertexCoordsVec.resize(numCoords);
+	if (rawPoints != nullptr)
+		prtu::widen(rawPoints, mVertexCoordsVec.data(), numCoords);
 
-	// faces
+	// faces: maya and prt indices have the same size, so we bulk copy the int arrays into the uint32 buffers
 	MIntArray vertexCount;
 	MIntArray vertexList;
 	meshFn.getVertices(vertexCount, vertexList);
 
-	mFaceCountsVec.reserve(vertexCount.length());
-	const auto vertexCountWrapper = mu::makeMArrayConstWrapper(vertexCount);
-	std::copy(vertexCountWrapper.begin(), vertexCountWrapper.end(), std::back_inserter(mFaceCountsVec));
+	static_assert(sizeof(int) == sizeof(uint32_t), "bulk copy of maya index arrays requires 32bit int");
+	mFaceCountsVec.resize(vertexCount.length());
+	if (!mFaceCountsVec.empty())
+		MCHECK(vertexCount.get(reinterpret_cast<int*>(mFaceCountsVec.data())));
+
+	mIndicesVec.resize(vertexList.length());
+	if (!mIndicesVec.empty())
+		MCHECK(vertexList.get(reinterpret_cast<int*>(mIndicesVec.data())));
 
-	mIndicesVec.reserve(vertexList.length());
-	const auto vertexListWrapper = mu::makeMArrayConstWrapper(vertexList);
-	std::copy(vertexListWrapper.begin(), vertexListWrapper.end(), std::back_inserter(mIndicesVec));
+	mGeometryHash = prtu::hash(mVertexCoordsVec);
+	mGeometryHash = prtu::hash(mFaceCountsVec, mGeometryHash);
+	mGeometryHash = prtu::hash(mIndicesVec, mGeometryHash);
 }
@@ -29,6 +29,7 @@ private:
 	std::vector<double> mVertexCoordsVec;
 	std::vector<uint32_t> mIndicesVec;
 	std::vector<uint32_t> mFaceCountsVec;
+	uint64_t mGeometryHash = 0;
 
 public:
 	explicit PRTMesh(const MObject& mesh);
@@ -56,4 +57,9 @@ public:
 	size_t faceCountsCount() const noexcept {
 		return mFaceCountsVec.size();
 	}
+
+	// identifies the geometry, e.g. to look up cached evaluation results
+	uint64_t geometryHash() const noexcept {
+		return mGeometryHash;
+	}
 };
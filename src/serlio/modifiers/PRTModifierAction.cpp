@@ -32,10 +32,15 @@
 #include "maya/MFnCompoundAttribute.h"
 #include "maya/MFnMesh.h"
 #include "maya/MFnNumericAttribute.h"
+#include "maya/MFnNumericData.h"
 #include "maya/MFnStringData.h"
 #include "maya/MFnTypedAttribute.h"
+#include "maya/MGlobal.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <sstream>
 
 #define CHECK_STATUS(st)                                                                                               \
 	if ((st) != MS::kSuccess) {                                                                                        \
@@ -57,12 +62,21 @@ constexpr const wchar_t* MIN_KEY = L"min";
 constexpr const wchar_t* MAX_KEY = L"max";
 constexpr const wchar_t* RESTRICTED_KEY = L"restricted";
 
+std::atomic<size_t> canceledGenerateCount(0);
+
+// idle task queued by the worker thread of an async generate (MGlobal::executeCommandOnIdle is not thread safe),
+// maya runs it on the main thread
+void executeOnDoneCommand(void* data) {
+	const std::unique_ptr<MString> onDoneCommand(static_cast<MString*>(data));
+	MGlobal::executeCommand(*onDoneCommand);
+}
+
 const AttributeMapUPtr
         EMPTY_ATTRIBUTES(AttributeMapBuilderUPtr(prt::AttributeMapBuilder::create())->createAttributeMap());
 
-AttributeMapUPtr getDefaultAttributeValues(const std::wstring& ruleFile, const std::wstring& startRule,
-                                           const prt::ResolveMap& resolveMap, prt::CacheObject& cache,
-                                           const PRTMesh& prtMesh) {
+AttributeMapUPtr evaluateDefaultAttributeValues(const std::wstring& ruleFile, const std::wstring& startRule,
+                                                const prt::ResolveMap& resolveMap, prt::CacheObject& cache,
+                                                const PRTMesh& prtMesh, int32_t seed) {
 	AttributeMapBuilderUPtr mayaCallbacksAttributeBuilder(prt::AttributeMapBuilder::create());
 	MayaCallbacks mayaCallbacks(MObject::kNullObj, MObject::kNullObj, mayaCallbacksAttributeBuilder);
 
@@ -71,8 +85,6 @@ AttributeMapUPtr getDefaultAttributeValues(const std::wstring& ruleFile, const s
 	isb->setGeometry(prtMesh.vertexCoords(), prtMesh.vcCount(), prtMesh.indices(), prtMesh.indicesCount(),
 	                 prtMesh.faceCounts(), prtMesh.faceCountsCount());
 
-	const int32_t seed = mu::computeSeed(prtMesh.vertexCoords(), prtMesh.vcCount());
-
 	isb->setAttributes(ruleFile.c_str(), startRule.c_str(), seed, L"", EMPTY_ATTRIBUTES.get(), &resolveMap);
 
 	const InitialShapeUPtr shape(isb->createInitialShapeAndReset());
@@ -94,7 +106,22 @@ AttributeMapUPtr getDefaultAttributeValues(const std::wstring& ruleFile, const s
 PRTModifierAction::PRTModifierAction() {
 	AttributeMapBuilderUPtr optionsBuilder(prt::AttributeMapBuilder::create());
 
-	mMayaEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA);
+	// the geometry is streamed per instance instead of being serialized into one big mesh first. Each instance is
+	// serialized on the encoder thread, only instances with many faces (e.g. a large imported asset) are serialized
+	// in parallel: a node generates a single initial shape, so PRT runs its encoder on one thread.
+	optionsBuilder->setBool(EO_EMIT_MESH_CHUNKS, true);
+	optionsBuilder->setBool(EO_PARALLEL_SERIALIZATION, true);
+	// maya meshes are single precision anyway
+	optionsBuilder->setBool(EO_FLOAT_VERTEX_DATA, true);
+	const AttributeMapUPtr mayaEncOptions(optionsBuilder->createAttributeMap()); // no reset, also for single pass
+	mMayaEncOpts = prtu::createValidatedOptions(ENC_ID_MAYA, mayaEncOptions.get());
+
+	// in single pass mode the attribute eval encoder reports the attribute values, the maya encoder must not
+	// interfere with its (leaf shape) values
+	optionsBuilder->setBool(EO_EMIT_ATTRIBUTES, false);
+	const AttributeMapUPtr singlePassMayaEncOptions(optionsBuilder->createAttributeMapAndReset());
+	mMayaEncOptsSinglePass = prtu::createValidatedOptions(ENC_ID_MAYA, singlePassMayaEncOptions.get());
+	mAttrEvalEncOpts = prtu::createValidatedOptions(ENC_ID_ATTR_EVAL);
 
 	optionsBuilder->setString(L"name", FILE_CGA_ERROR);
 	const AttributeMapUPtr errOptions(optionsBuilder->createAttributeMapAndReset());
@@ -105,6 +132,14 @@ PRTModifierAction::PRTModifierAction() {
 	mCGAPrintOptions = prtu::createValidatedOptions(ENC_ID_CGA_PRINT, printOptions.get());
 }
 
+PRTModifierAction::~PRTModifierAction() {
+	// abort a running generate, its result is not needed anymore and the destructor of the future waits for it
+	if (mAsyncJob) {
+		mAsyncJob->abandoned = true;
+		mAsyncJob->canceled = true;
+	}
+}
+
 std::list<MObject> getNodeAttributesCorrespondingToCGA(const MFnDependencyNode& node) {
 	std::list<MObject> rawAttrs;
 	std::list<MObject> ignoreList;
@@ -146,36 +181,31 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 	const MFnDependencyNode fNode(node, &stat);
 	MCHECK(stat);
 
-	auto resolveMap = getResolveMap();
-	if (!resolveMap)
-		return MStatus::kInvalidParameter;
-
-	const wchar_t* ruleFileURI = resolveMap->getString(mRuleFile.c_str());
-	if (ruleFileURI == nullptr)
+	if (!mRulePackageInfo)
 		return MStatus::kInvalidParameter;
+	const ResolveMapCache::RulePackageInfo& rulePackageInfo = *mRulePackageInfo;
 
-	const RuleFileInfoUPtr info(prt::createRuleFileInfo(ruleFileURI));
-
-	auto reverseLookupAttribute = [this](const std::wstring& mayaFullAttrName) {
-		auto it = std::find_if(mRuleAttributes.begin(), mRuleAttributes.end(),
-		                       [&mayaFullAttrName](const auto& ra) { return (ra.mayaFullName == mayaFullAttrName); });
-		if (it != mRuleAttributes.end())
-			return *it;
-		return RULE_NOT_FOUND;
+	auto reverseLookupAttribute = [&rulePackageInfo](const std::wstring& mayaFullAttrName) -> const RuleAttribute& {
+		const RuleAttribute* ruleAttr = rulePackageInfo.findByMayaFullName(mayaFullAttrName);
+		return (ruleAttr != nullptr) ? *ruleAttr : RULE_NOT_FOUND;
 	};
 
 	const std::list<MObject> cgaAttributes = getNodeAttributesCorrespondingToCGA(fNode);
 
-	const AttributeMapUPtr defaultAttributeValues =
-	        getDefaultAttributeValues(mRuleFile, mStartRule, *getResolveMap(), *PRTContext::get().theCache, *inPrtMesh);
+	// single and multi pass mode both compare against the (cached) rule default values, i.e. the same rule attributes
+	// are passed to generate in both modes (the single pass generate call refreshes the cache entry)
+	const AttributeMapSPtr defaultAttributeValues = getDefaultAttributeValues();
+	if (!defaultAttributeValues)
+		return MStatus::kFailure;
 	AttributeMapBuilderUPtr aBuilder(prt::AttributeMapBuilder::create());
+	AttributeMapBuilderUPtr nodeValuesBuilder(prt::AttributeMapBuilder::create());
 
 	for (const auto& attrObj : cgaAttributes) {
 		MFnAttribute fnAttr(attrObj);
 		const MPlug plug(node, attrObj);
 
 		const MString fullAttrName = fnAttr.name();
-		const RuleAttribute ruleAttr = reverseLookupAttribute(fullAttrName.asWChar());
+		const RuleAttribute& ruleAttr = reverseLookupAttribute(fullAttrName.asWChar());
 		assert(!ruleAttr.fqName.empty()); // poor mans check for RULE_NOT_FOUND
 
 		const std::wstring fqAttrName = ruleAttr.fqName;
@@ -189,24 +219,17 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 
 				bool val;
 				MCHECK(plug.getValue(val));
-
-				const auto defVal = defaultAttributeValues->getBool(fqAttrName.c_str());
-				if (val != defVal)
-					aBuilder->setBool(fqAttrName.c_str(), val);
+				nodeValuesBuilder->setBool(fqAttrName.c_str(), val);
 			}
 			else if (nAttr.unitType() == MFnNumericData::kDouble) {
 				assert(ruleAttrType == prt::AAT_FLOAT);
 
 				double val;
 				MCHECK(plug.getValue(val));
-
-				const auto defVal = defaultAttributeValues->getFloat(fqAttrName.c_str());
-				if (val != defVal)
-					aBuilder->setFloat(fqAttrName.c_str(), val);
+				nodeValuesBuilder->setFloat(fqAttrName.c_str(), val);
 			}
 			else if (nAttr.isUsedAsColor()) {
 				assert(ruleAttrType == prt::AAT_STR);
-				const wchar_t* defColStr = defaultAttributeValues->getString(fqAttrName.c_str());
 
 				MObject rgb;
 				MCHECK(plug.getValue(rgb));
@@ -214,10 +237,7 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 
 				prtu::Color col;
 				MCHECK(fRGB.getData3Float(col[0], col[1], col[2]));
-				const std::wstring colStr = prtu::getColorString(col);
-
-				if (std::wcscmp(colStr.c_str(), defColStr) != 0)
-					aBuilder->setString(fqAttrName.c_str(), colStr.c_str());
+				nodeValuesBuilder->setString(fqAttrName.c_str(), prtu::getColorString(col).c_str());
 			}
 		}
 		else if (attrObj.hasFn(MFn::kTypedAttribute)) {
@@ -225,10 +245,7 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 
 			MString val;
 			MCHECK(plug.getValue(val));
-
-			const auto defVal = defaultAttributeValues->getString(fqAttrName.c_str());
-			if (std::wcscmp(val.asWChar(), defVal) != 0)
-				aBuilder->setString(fqAttrName.c_str(), val.asWChar());
+			nodeValuesBuilder->setString(fqAttrName.c_str(), val.asWChar());
 		}
 		else if (attrObj.hasFn(MFn::kEnumAttribute)) {
 			MFnEnumAttribute eAttr(attrObj);
@@ -255,74 +272,147 @@ MStatus PRTModifierAction::fillAttributesFromNode(const MObject& node) {
 		}
 	}
 
-	mGenerateAttrs.reset(aBuilder->createAttributeMap());
+	const AttributeMapUPtr nodeValues(nodeValuesBuilder->createAttributeMap());
+	prtu::setChangedAttributes(*aBuilder, *nodeValues, *defaultAttributeValues);
+
+	mGenerateAttrs.reset(aBuilder->createAttributeMap(), PRTDestroyer());
 	return MStatus::kSuccess;
 }
 
 // Sets the mesh object for the action  to operate on
-void PRTModifierAction::setMesh(MObject& _inMesh, MObject& _outMesh) {
+void PRTModifierAction::setMesh(MObject& _inMesh, MObject& _outMesh, bool inMeshChanged) {
 	inMesh = _inMesh;
 	outMesh = _outMesh;
+	mGeneratedMesh = MObject::kNullObj;
 
-	inPrtMesh = std::make_unique<PRTMesh>(_inMesh);
+	if (inMeshChanged || !inPrtMesh) {
+		inPrtMesh = std::make_unique<PRTMesh>(_inMesh);
+		mInitialShapeBuilder.reset();
+	}
+	else if (DBG)
+		LOG_DBG << "reusing prt mesh of unchanged input geometry";
 }
 
 ResolveMapSPtr PRTModifierAction::getResolveMap() {
 	ResolveMapCache::LookupResult lookupResult =
 	        PRTContext::get().mResolveMapCache->get(std::wstring(mRulePkg.asWChar()));
-	ResolveMapSPtr resolveMap = lookupResult.first;
-	return resolveMap;
+	mResolveMap = lookupResult.first;
+	return mResolveMap;
+}
+
+// The default attribute values only depend on the rule package, the start rule and the initial shape.
+// Evaluating them requires a full generate call, so we cache them across compute calls and nodes.
+AttributeMapSPtr PRTModifierAction::getDefaultAttributeValues() {
+	ResolveMapSPtr resolveMap = getResolveMap();
+	if (!resolveMap || !inPrtMesh)
+		return {};
+
+	const int32_t seed = mu::computeSeed(inPrtMesh->vertexCoords(), inPrtMesh->vcCount());
+	const auto evaluate = [this, &resolveMap, seed]() {
+		return evaluateDefaultAttributeValues(mRuleFile, mStartRule, *resolveMap, *PRTContext::get().theCache,
+		                                      *inPrtMesh, seed);
+	};
+	return PRTContext::get().mDefaultAttributeValuesCache->get(getDefaultAttributeValuesKey(seed), evaluate);
+}
+
+DefaultAttributeValuesCache::Key PRTModifierAction::getDefaultAttributeValuesKey(int32_t seed) const {
+	const std::wstring rulePkg(mRulePkg.asWChar());
+	const time_t rulePkgTimeStamp = PRTContext::get().mResolveMapCache->getTimeStamp(rulePkg);
+	return {rulePkg, rulePkgTimeStamp, mRuleFile, mStartRule, seed, inPrtMesh->geometryHash()};
+}
+
+void PRTModifierAction::putEvaluatedAttributeValues(const AttributeMapSPtr& evaluatedAttrs) {
+	// without any user values and with the default seed of the geometry (see getDefaultAttributeValues()) the
+	// evaluated attributes are the default values
+	size_t keyCount = 0;
+	if (mGenerateAttrs)
+		mGenerateAttrs->getKeys(&keyCount);
+	const int32_t seed = mu::computeSeed(inPrtMesh->vertexCoords(), inPrtMesh->vcCount());
+	if (keyCount == 0 && mRandomSeed == seed)
+		PRTContext::get().mDefaultAttributeValuesCache->put(getDefaultAttributeValuesKey(seed), evaluatedAttrs);
 }
 
 MStatus PRTModifierAction::updateRuleFiles(const MObject& node, const MString& rulePkg) {
+	// acquire the new rule package before the previous one is released, otherwise an unchanged rule package might be
+	// evicted (and unpacked again) in between. The rule file info and the sorted rule attributes are cached together
+	// with the resolve map.
+	const std::wstring rulePkgPath(rulePkg.asWChar());
+	ResolveMapSPtr resolveMap = PRTContext::get().mResolveMapCache->get(rulePkgPath).first;
+	ResolveMapCache::RulePackageInfoSPtr rulePackageInfo =
+	        PRTContext::get().mResolveMapCache->getRulePackageInfo(rulePkgPath, PRTContext::get().theCache.get());
+
 	mRulePkg = rulePkg;
 
 	mEnums.clear();
 	mRuleFile.clear();
 	mStartRule.clear();
-	mRuleAttributes.clear();
-
-	ResolveMapSPtr resolveMap = getResolveMap();
-	if (!resolveMap) {
-		LOG_ERR << "failed to get resolve map from rule package " << mRulePkg.asWChar();
+	mResolveMap = std::move(resolveMap);
+	mRulePackageInfo = std::move(rulePackageInfo);
+	if (!mRulePackageInfo) {
+		LOG_ERR << "could not get resolve map or rule file info from rule package " << mRulePkg.asWChar();
 		return MS::kFailure;
 	}
 
-	mRuleFile = prtu::getRuleFileEntry(resolveMap);
-	if (mRuleFile.empty()) {
-		LOG_ERR << "could not find rule file in rule package " << mRulePkg.asWChar();
-		return MS::kFailure;
-	}
+	mRuleFile = mRulePackageInfo->ruleFile;
+	mStartRule = mRulePackageInfo->startRule;
 
-	prt::Status infoStatus = prt::STATUS_UNSPECIFIED_ERROR;
-	const wchar_t* ruleFileURI = resolveMap->getString(mRuleFile.c_str());
-	if (ruleFileURI == nullptr) {
-		LOG_ERR << "could not find rule file URI in resolve map of rule package " << mRulePkg.asWChar();
-		return MS::kFailure;
-	}
+	if (node != MObject::kNullObj) {
+		mGenerateAttrs = getDefaultAttributeValues();
+		if (!mGenerateAttrs) {
+			LOG_ERR << "could not evaluate default attribute values of rule file " << mRuleFile;
+			return MS::kFailure;
+		}
+		if (DBG)
+			LOG_DBG << "default attrs: " << prtu::objectToXML(mGenerateAttrs);
 
-	RuleFileInfoUPtr info(prt::createRuleFileInfo(ruleFileURI, PRTContext::get().theCache.get(), &infoStatus));
-	if (!info || infoStatus != prt::STATUS_OK) {
-		LOG_ERR << "could not get rule file info from rule file " << mRuleFile;
-		return MS::kFailure;
+		// populate node with dynamic rule attributes
+		createNodeAttributes(node, mRulePackageInfo->ruleFileInfo.get());
 	}
 
-	mStartRule = prtu::detectStartRule(info);
+	return MS::kSuccess;
+}
 
-	if (node != MObject::kNullObj) {
-		mGenerateAttrs = getDefaultAttributeValues(mRuleFile, mStartRule, *getResolveMap(), *PRTContext::get().theCache,
-		                                           *inPrtMesh);
-		if (DBG)
-			LOG_DBG << "default attrs: " << prtu::objectToXML(mGenerateAttrs);
+InitialShapeUPtr PRTModifierAction::createInitialShape() {
+	if (!mInitialShapeBuilder) {
+		mInitialShapeBuilder.reset(prt::InitialShapeBuilder::create());
+		const prt::Status setGeoStatus = mInitialShapeBuilder->setGeometry(
+		        inPrtMesh->vertexCoords(), inPrtMesh->vcCount(), inPrtMesh->indices(), inPrtMesh->indicesCount(),
+		        inPrtMesh->faceCounts(), inPrtMesh->faceCountsCount());
+		if (setGeoStatus != prt::STATUS_OK)
+			LOG_ERR << "InitialShapeBuilder setGeometry failed status = " << prt::getStatusDescription(setGeoStatus);
+	}
 
-		// derive necessary data from PRT rule info to populate node with dynamic rule attributes
-		mRuleAttributes = getRuleAttributes(mRuleFile, info.get());
-		sortRuleAttributes(mRuleAttributes);
+	mInitialShapeBuilder->setAttributes(mRuleFile.c_str(), mStartRule.c_str(), mRandomSeed, L"", mGenerateAttrs.get(),
+	                                    getResolveMap().get());
 
-		createNodeAttributes(node, info.get());
+	// no reset: keep the geometry for the next call
+	return InitialShapeUPtr(mInitialShapeBuilder->createInitialShape());
+}
+
+void PRTModifierAction::getEncoders(std::vector<const wchar_t*>& encIDs, AttributeMapNOPtrVector& encOpts,
+                                    bool singlePass) const {
+	encIDs = {ENC_ID_MAYA, ENC_ID_CGA_ERROR, ENC_ID_CGA_PRINT};
+	encOpts = {mMayaEncOpts.get(), mCGAErrorOptions.get(), mCGAPrintOptions.get()};
+	if (singlePass) {
+		// evaluate the rule attributes in the same generate call (instead of a separate one)
+		encIDs.push_back(ENC_ID_ATTR_EVAL);
+		encOpts.front() = mMayaEncOptsSinglePass.get();
+		encOpts.push_back(mAttrEvalEncOpts.get());
 	}
+	assert(encIDs.size() == encOpts.size());
+}
 
-	return MS::kSuccess;
+// identifies the inputs of a generate call, used to match results which have been generated in a batch
+uint64_t PRTModifierAction::getGenerateSignature() const {
+	std::wostringstream wss;
+	wss << mRulePkg.asWChar() << L';' << mRuleFile << L';' << mStartRule << L';' << mRandomSeed << L';';
+	const std::wstring inputs = wss.str();
+	const std::string attrs = mGenerateAttrs ? prtu::objectToXML(mGenerateAttrs) : std::string();
+
+	uint64_t signature = inPrtMesh ? inPrtMesh->geometryHash() : 0;
+	signature = prtu::hash(inputs.data(), inputs.size() * sizeof(wchar_t), signature);
+	signature = prtu::hash(attrs.data(), attrs.size(), signature);
+	return signature;
 }
 
 MStatus PRTModifierAction::doIt() {
@@ -330,22 +420,14 @@ MStatus PRTModifierAction::doIt() {
 
 	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
 	std::unique_ptr<MayaCallbacks> outputHandler(new MayaCallbacks(inMesh, outMesh, amb));
+	if (!mReusableMesh.isNull())
+		outputHandler->setReusableMesh(mReusableMesh, mGeneratedTopologyHash);
 
-	InitialShapeBuilderUPtr isb(prt::InitialShapeBuilder::create());
-	const prt::Status setGeoStatus =
-	        isb->setGeometry(inPrtMesh->vertexCoords(), inPrtMesh->vcCount(), inPrtMesh->indices(),
-	                         inPrtMesh->indicesCount(), inPrtMesh->faceCounts(), inPrtMesh->faceCountsCount());
-	if (setGeoStatus != prt::STATUS_OK)
-		LOG_ERR << "InitialShapeBuilder setGeometry failed status = " << prt::getStatusDescription(setGeoStatus);
-
-	isb->setAttributes(mRuleFile.c_str(), mStartRule.c_str(), mRandomSeed, L"", mGenerateAttrs.get(),
-	                   getResolveMap().get());
+	const InitialShapeUPtr shape = createInitialShape();
 
-	std::unique_ptr<const prt::InitialShape, PRTDestroyer> shape(isb->createInitialShapeAndReset());
-
-	const std::vector<const wchar_t*> encIDs = {ENC_ID_MAYA, ENC_ID_CGA_ERROR, ENC_ID_CGA_PRINT};
-	const AttributeMapNOPtrVector encOpts = {mMayaEncOpts.get(), mCGAErrorOptions.get(), mCGAPrintOptions.get()};
-	assert(encIDs.size() == encOpts.size());
+	std::vector<const wchar_t*> encIDs;
+	AttributeMapNOPtrVector encOpts;
+	getEncoders(encIDs, encOpts, mSinglePass);
 
 	InitialShapeNOPtrVector shapes = {shape.get()};
 	const prt::Status generateStatus =
@@ -353,16 +435,98 @@ MStatus PRTModifierAction::doIt() {
 	                      outputHandler.get(), PRTContext::get().theCache.get(), nullptr);
 	if (generateStatus != prt::STATUS_OK)
 		LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+	if (outputHandler->hasOutputMesh()) {
+		mGeneratedMesh = outputHandler->getOutputMesh();
+		mGeneratedTopologyHash = outputHandler->getTopologyHash();
+	}
+	mReusableMesh = MObject::kNullObj;
+
+	if (mSinglePass && generateStatus == prt::STATUS_OK)
+		putEvaluatedAttributeValues(AttributeMapSPtr(amb->createAttributeMap(), PRTDestroyer()));
 
 	return status;
 }
 
+void PRTModifierAction::startAsyncGenerate(uint64_t signature, const MString& onDoneCommand) {
+	assert(!isAsyncGenerateRunning());
+
+	auto job = std::make_unique<AsyncGenerateJob>();
+	job->signature = signature;
+	job->singlePass = mSinglePass;
+	job->shape = createInitialShape();
+
+	std::vector<const wchar_t*> encIDs;
+	AttributeMapNOPtrVector encOpts;
+	getEncoders(encIDs, encOpts, mSinglePass);
+
+	// the initial shape refers to the resolve map, keep it alive even if it gets evicted from the cache meanwhile
+	const ResolveMapSPtr resolveMap = getResolveMap();
+
+	AsyncGenerateJob* j = job.get();
+	job->status = std::async(std::launch::async, [j, encIDs, encOpts, resolveMap, onDoneCommand]() {
+		const InitialShapeNOPtrVector shapes = {j->shape.get()};
+		const prt::Status generateStatus =
+		        prt::generate(shapes.data(), shapes.size(), nullptr, encIDs.data(), encIDs.size(), encOpts.data(),
+		                      &j->callbacks, PRTContext::get().theCache.get(), nullptr);
+		if (j->canceled) {
+			// only count generate calls which have actually been aborted because of outdated inputs
+			if (generateStatus == prt::STATUS_CANCELED && !j->abandoned)
+				canceledGenerateCount++;
+			if (DBG)
+				LOG_DBG << "canceled outdated generate, status = " << prt::getStatusDescription(generateStatus);
+		}
+		else if (generateStatus != prt::STATUS_OK)
+			LOG_ERR << "prt generate failed: " << prt::getStatusDescription(generateStatus);
+
+		MGlobal::executeTaskOnIdle(executeOnDoneCommand, new MString(onDoneCommand));
+		return generateStatus;
+	});
+
+	mAsyncJob = std::move(job);
+}
+
+bool PRTModifierAction::isAsyncGenerateRunning() const {
+	return mAsyncJob && mAsyncJob->status.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+void PRTModifierAction::cancelOutdatedAsyncGenerate(uint64_t signature) {
+	if (isAsyncGenerateRunning() && mAsyncJob->signature != signature)
+		mAsyncJob->canceled = true;
+}
+
+size_t PRTModifierAction::getCanceledGenerateCount() {
+	return canceledGenerateCount;
+}
+
+bool PRTModifierAction::applyAsyncResult(uint64_t signature) {
+	if (!mAsyncJob || isAsyncGenerateRunning())
+		return false;
+
+	const std::unique_ptr<AsyncGenerateJob> job = std::move(mAsyncJob);
+	if (job->signature != signature || job->canceled)
+		return false; // outdated, the inputs changed while generating
+
+	// a failed generate is "applied" as well (i.e. we keep the input mesh), otherwise we would retry forever
+	if (job->status.get() == prt::STATUS_OK) {
+		AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+		MayaCallbacks mayaCallbacks(inMesh, outMesh, amb);
+		job->callbacks.replay(mayaCallbacks);
+		if (mayaCallbacks.hasOutputMesh()) {
+			mGeneratedMesh = mayaCallbacks.getOutputMesh();
+			mGeneratedTopologyHash = mayaCallbacks.getTopologyHash();
+		}
+		if (job->singlePass)
+			putEvaluatedAttributeValues(job->callbacks.createAttributeMap());
+	}
+	return true;
+}
+
 MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const prt::RuleFileInfo* info) {
 	MStatus stat;
 	MFnDependencyNode node(nodeObj, &stat);
 	MCHECK(stat);
 
-	for (const RuleAttribute& p : mRuleAttributes) {
+	for (const RuleAttribute& p : mRulePackageInfo->ruleAttributes) {
 		const std::wstring fqName = p.fqName;
 
 		// only use attributes of current style
@@ -523,10 +687,9 @@ MStatus PRTModifierAction::createNodeAttributes(const MObject& nodeObj, const pr
 }
 
 void PRTModifierAction::removeUnusedAttribs(MFnDependencyNode& node) {
-	auto isInUse = [this](const MString& attrName) {
-		auto it = std::find_if(mRuleAttributes.begin(), mRuleAttributes.end(),
-		                       [&attrName](const auto& ra) { return (ra.mayaFullName == attrName.asWChar()); });
-		return (it != mRuleAttributes.end());
+	const ResolveMapCache::RulePackageInfoSPtr& rulePackageInfo = mRulePackageInfo;
+	auto isInUse = [&rulePackageInfo](const MString& attrName) {
+		return rulePackageInfo && (rulePackageInfo->findByMayaFullName(attrName.asWChar()) != nullptr);
 	};
 
 	std::list<MObject> attrToRemove;
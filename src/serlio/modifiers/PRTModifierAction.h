@@ -20,6 +20,7 @@
 #pragma once
 
 #include "modifiers/PRTMesh.h"
+#include "modifiers/RecordingCallbacks.h"
 #include "modifiers/RuleAttributes.h"
 #include "modifiers/polyModifier/polyModifierFty.h"
 
@@ -37,6 +38,7 @@
 #include "maya/MString.h"
 #include "maya/MStringArray.h"
 
+#include <future>
 #include <list>
 #include <map>
 
@@ -65,29 +67,71 @@ class PRTModifierAction : public polyModifierFty {
 
 public:
 	explicit PRTModifierAction();
+	~PRTModifierAction() override;
 
 	MStatus updateRuleFiles(const MObject& node, const MString& rulePkg);
 	MStatus fillAttributesFromNode(const MObject& node);
-	void setMesh(MObject& _inMesh, MObject& _outMesh);
+	// inMeshChanged = false allows to reuse the prt geometry of the previous call
+	void setMesh(MObject& _inMesh, MObject& _outMesh, bool inMeshChanged = true);
 	void setRandomSeed(int32_t randomSeed) {
 		mRandomSeed = randomSeed;
 	};
+	void setSinglePass(bool singlePass) {
+		mSinglePass = singlePass;
+	}
 
 	// polyModifierFty inherited methods
 	MStatus doIt() override;
 
+	// building blocks of doIt(), e.g. to generate several actions in one batch
+	InitialShapeUPtr createInitialShape();
+	void getEncoders(std::vector<const wchar_t*>& encIDs, AttributeMapNOPtrVector& encOpts, bool singlePass) const;
+	uint64_t getGenerateSignature() const;
+
+	const MObject& getInMesh() const {
+		return inMesh;
+	}
+	// the mesh written by the last doIt() or applyAsyncResult(): outMesh (or new mesh data if outMesh is null), the
+	// reusable mesh or null if nothing has been generated
+	const MObject& getGeneratedMesh() const {
+		return mGeneratedMesh;
+	}
+	// the mesh written by the previous doIt(), doIt() only updates its vertices if the generated topology is unchanged
+	void setReusableMesh(const MObject& mesh) {
+		mReusableMesh = mesh;
+	}
+
+	// asynchronous generation: prt::generate runs on a worker thread, the result is applied to outMesh by a later
+	// call on the main thread. onDoneCommand is executed on idle (on the main thread) when the worker thread has
+	// finished.
+	void startAsyncGenerate(uint64_t signature, const MString& onDoneCommand);
+	bool isAsyncGenerateRunning() const;
+	// aborts the running generate if it has been started for other inputs than the given ones
+	void cancelOutdatedAsyncGenerate(uint64_t signature);
+	// number of asynchronous generate calls which have been aborted because their inputs were outdated
+	static size_t getCanceledGenerateCount();
+	// returns false if there is no finished result for these generate inputs (see getGenerateSignature())
+	bool applyAsyncResult(uint64_t signature);
+
 private:
 	// init in PRTModifierAction::PRTModifierAction()
 	AttributeMapUPtr mMayaEncOpts;
 	AttributeMapUPtr mCGAPrintOptions;
 	AttributeMapUPtr mCGAErrorOptions;
+	AttributeMapUPtr mMayaEncOptsSinglePass;
+	AttributeMapUPtr mAttrEvalEncOpts;
 
 	// Mesh Nodes: only used during doIt
 	MObject inMesh;
 	MObject outMesh;
+	MObject mGeneratedMesh;
+	MObject mReusableMesh;
+	uint64_t mGeneratedTopologyHash = 0;
 
 	// PRT representation for the geometry of inMesh
 	std::unique_ptr<PRTMesh> inPrtMesh;
+	// holds the geometry of inPrtMesh, only the attributes get updated between generate calls
+	InitialShapeBuilderUPtr mInitialShapeBuilder;
 
 	// Set in updateRuleFiles(rulePkg)
 	MString mRulePkg;
@@ -95,14 +139,34 @@ private:
 	std::wstring mStartRule;
 	const std::wstring mRuleStyle = L"Default"; // Serlio atm only supports the "Default" style
 	int32_t mRandomSeed = 0;
-	RuleAttributes mRuleAttributes; // TODO: could be cached together with ResolveMap
+	bool mSinglePass = false;
+	ResolveMapCache::RulePackageInfoSPtr mRulePackageInfo; // shared by all actions using the same rule package
+	// keeps the rule package in use, i.e. the ResolveMapCache does not evict it while the node exists
+	ResolveMapSPtr mResolveMap;
 
 	ResolveMapSPtr getResolveMap();
+	AttributeMapSPtr getDefaultAttributeValues();
+	DefaultAttributeValuesCache::Key getDefaultAttributeValuesKey(int32_t seed) const;
+	// stores the attribute values evaluated by a single pass generate, if they are the default values
+	void putEvaluatedAttributeValues(const AttributeMapSPtr& evaluatedAttrs);
 
 	// init in fillAttributesFromNode()
-	AttributeMapUPtr mGenerateAttrs;
+	AttributeMapSPtr mGenerateAttrs;
 
 	std::list<PRTModifierEnum> mEnums;
+
+	struct AsyncGenerateJob {
+		uint64_t signature = 0;
+		bool singlePass = false;
+		InitialShapeUPtr shape;
+		std::atomic<bool> canceled{false};
+		std::atomic<bool> abandoned{false}; // canceled because the action is destroyed, not because of new inputs
+		RecordingCallbacks callbacks{&canceled};
+		std::future<prt::Status> status;
+	};
+	// must be destroyed before the encoder options, the destructor of the future waits for the worker thread
+	std::unique_ptr<AsyncGenerateJob> mAsyncJob;
+
 	//	std::map<std::wstring, std::wstring> mBriefName2prtAttr;
 	MStatus createNodeAttributes(const MObject& node, const prt::RuleFileInfo* info);
 	void removeUnusedAttribs(MFnDependencyNode& node);
@@ -24,6 +24,7 @@
 #include "serlioPlugin.h"
 
 #include "maya/MDataHandle.h"
+#include "maya/MFnDependencyNode.h"
 #include "maya/MFnMeshData.h"
 #include "maya/MFnNumericAttribute.h"
 #include "maya/MFnStringData.h"
@@ -38,6 +39,9 @@
 namespace {
 const MString NAME_RULE_PKG = "Rule_Package";
 const MString NAME_RANDOM_SEED = "Random_Seed";
+const MString NAME_SINGLE_PASS = "Single_Pass";
+const MString NAME_ASYNC_GENERATE = "Async_Generate";
+
 } // namespace
 
 // Unique Node TypeId
@@ -45,9 +49,15 @@ MTypeId PRTModifierNode::id(SerlioNodeIDs::SERLIO_PREFIX, SerlioNodeIDs::PRT_GEO
 MObject PRTModifierNode::rulePkg;
 MObject PRTModifierNode::currentRulePkg;
 MObject PRTModifierNode::mRandomSeed;
+MObject PRTModifierNode::mSinglePass;
+MObject PRTModifierNode::mAsyncGenerate;
 
 // make sure the dynamically added plugs affect the outMesh
-MStatus PRTModifierNode::setDependentsDirty(const MPlug& /*plugBeingDirtied*/, MPlugArray& affectedPlugs) {
+MStatus PRTModifierNode::setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& affectedPlugs) {
+	// most of the time only rule attributes change, in this case we can keep the prt representation of inMesh
+	if (plugBeingDirtied == inMesh)
+		mInMeshDirty = true;
+
 	const MPlug pOutMesh(thisMObject(), outMesh);
 	affectedPlugs.append(pOutMesh);
 	return MS::kSuccess;
@@ -94,15 +104,19 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 			MDataHandle currentRulePkgData = data.inputValue(currentRulePkg, &status);
 			MCheckStatus(status, "ERROR getting currentRulePkg");
 
-			// Copy the inMesh to the outMesh, so you can
-			// perform operations directly on outMesh
-			//
-			outputData.set(inputData.asMesh());
-			MObject iMesh = outputData.asMesh();
-			MObject oMesh = outputData.asMesh();
+			// PRT builds its geometry directly into a new mesh data object, the inMesh is only passed through to
+			// the outMesh if nothing has been generated. The null oMesh defers the creation of the mesh data to
+			// MayaCallbacks, which only needs it if the previous outMesh cannot be updated in place.
+			MObject iMesh = inputData.asMesh();
+			MObject previousOutMesh = outputData.asMesh();
+			MObject oMesh;
 
 			// Set the mesh object and component List on the factory
-			fPRTModifierAction.setMesh(iMesh, oMesh);
+			fPRTModifierAction.setMesh(iMesh, oMesh, mInMeshDirty);
+			mInMeshDirty = false;
+
+			MDataHandle singlePass = data.inputValue(mSinglePass, &status);
+			fPRTModifierAction.setSinglePass(singlePass.asBool());
 
 			if (rulePkgData.asString() != currentRulePkgData.asString()) {
 				fPRTModifierAction.updateRuleFiles(thisMObject(), rulePkgData.asString());
@@ -115,8 +129,64 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 			MDataHandle randomSeed = data.inputValue(mRandomSeed, &status);
 			fPRTModifierAction.setRandomSeed(randomSeed.asInt());
 
-			// Now, perform the PRT
-			status = fPRTModifierAction.doIt();
+			// Now, perform the PRT (unless serlioGenerateAll already did it for us)
+			MObject outMeshData = iMesh;
+			if (!mBatchResultMesh.isNull() &&
+			    mBatchResultSignature == fPRTModifierAction.getGenerateSignature()) {
+				outMeshData = mBatchResultMesh;
+			}
+			else if (data.inputValue(mAsyncGenerate).asBool()) {
+				// show the last result (or the input mesh) until the worker thread is done, when it is done
+				// it dirties outMesh and we apply the result here in the next compute
+				const uint64_t signature = fPRTModifierAction.getGenerateSignature();
+				if (fPRTModifierAction.applyAsyncResult(signature)) {
+					if (!fPRTModifierAction.getGeneratedMesh().isNull())
+						outMeshData = fPRTModifierAction.getGeneratedMesh();
+					// the async result is always built into a new mesh data object, so it can be shared as is
+					mLastGoodMesh = fPRTModifierAction.getGeneratedMesh();
+					mLastGoodSignature = signature;
+					mHasLastGoodMesh = true;
+				}
+				else if (mHasLastGoodMesh && mLastGoodSignature == signature) {
+					// the applied result is still up to date (e.g. the inputs have been changed back while
+					// generating), there is no need to generate it again
+					fPRTModifierAction.cancelOutdatedAsyncGenerate(signature);
+					if (!mLastGoodMesh.isNull())
+						outMeshData = mLastGoodMesh;
+				}
+				else {
+					// abort a generate for outdated inputs (e.g. while scrubbing an attribute slider), when it
+					// returns we end up here again and start a new generate with the latest inputs
+					fPRTModifierAction.cancelOutdatedAsyncGenerate(signature);
+					if (!fPRTModifierAction.isAsyncGenerateRunning()) {
+						const MString nodeName = MFnDependencyNode(thisMObject()).name();
+						const MString onDoneCommand =
+						        "if (`objExists " + nodeName + "`) dgdirty " + nodeName + ".outMesh;";
+						fPRTModifierAction.startAsyncGenerate(signature, onDoneCommand);
+					}
+					if (!mLastGoodMesh.isNull())
+						outMeshData = mLastGoodMesh;
+				}
+			}
+			else {
+				// only reuse the current outMesh if it has been generated by doIt(), it might also be the inMesh.
+				// Updating it in place is safe (like the output data of maya's polyModifierNode): it is the value
+				// of our own outMesh, which is dirty while we compute it, so downstream nodes evaluate it again,
+				// and the other references we keep to it (mLastGoodMesh, mBatchResultMesh) are reset below.
+				if (mOutMeshGenerated)
+					fPRTModifierAction.setReusableMesh(previousOutMesh);
+				status = fPRTModifierAction.doIt();
+				if (!fPRTModifierAction.getGeneratedMesh().isNull())
+					outMeshData = fPRTModifierAction.getGeneratedMesh();
+				mLastGoodMesh = MObject::kNullObj;
+				mHasLastGoodMesh = false;
+			}
+			mBatchResultMesh = MObject::kNullObj;
+			// a reused mesh has been updated in place and is already set
+			const MObject& generatedMesh = fPRTModifierAction.getGeneratedMesh();
+			mOutMeshGenerated = !generatedMesh.isNull() && (outMeshData == generatedMesh);
+			if (!mOutMeshGenerated || (outMeshData != previousOutMesh))
+				outputData.set(outMeshData);
 
 			currentRulePkgData.setString(rulePkgData.asString());
 
@@ -131,6 +201,42 @@ MStatus PRTModifierNode::compute(const MPlug& plug, MDataBlock& data) {
 	return status;
 }
 
+PRTModifierAction* PRTModifierNode::prepareBatchGenerate() {
+	MStatus status;
+	const MObject node = thisMObject();
+
+	MString rulePkgValue;
+	MString currentRulePkgValue;
+	MCHECK(MPlug(node, rulePkg).getValue(rulePkgValue));
+	MCHECK(MPlug(node, currentRulePkg).getValue(currentRulePkgValue));
+	if (rulePkgValue.length() == 0 || rulePkgValue != currentRulePkgValue)
+		return nullptr; // the rule attributes need to be (re-)created by compute first
+
+	MObject inMeshData;
+	status = MPlug(node, inMesh).getValue(inMeshData);
+	if (status != MS::kSuccess || inMeshData.isNull())
+		return nullptr;
+
+	bool singlePass = false;
+	int randomSeed = 0;
+	MCHECK(MPlug(node, mSinglePass).getValue(singlePass));
+	MCHECK(MPlug(node, mRandomSeed).getValue(randomSeed));
+
+	fPRTModifierAction.setMesh(inMeshData, inMeshData, mInMeshDirty);
+	mInMeshDirty = false;
+	fPRTModifierAction.setSinglePass(singlePass);
+	if (fPRTModifierAction.fillAttributesFromNode(node) != MS::kSuccess)
+		return nullptr;
+	fPRTModifierAction.setRandomSeed(randomSeed);
+
+	return &fPRTModifierAction;
+}
+
+void PRTModifierNode::setBatchResult(const MObject& meshData, uint64_t signature) {
+	mBatchResultMesh = meshData;
+	mBatchResultSignature = signature;
+}
+
 MStatus PRTModifierNode::initialize()
 // Description:
 //  This method is called to create and initialize all of the attributes
@@ -192,6 +298,22 @@ MStatus PRTModifierNode::initialize()
 	MCHECK(addAttribute(mRandomSeed));
 	MCHECK(attributeAffects(mRandomSeed, outMesh));
 
+	mSinglePass = nAttr.create(NAME_SINGLE_PASS, "singlePass", MFnNumericData::kBoolean, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Single Pass Generate")));
+	MCHECK(addAttribute(mSinglePass));
+	MCHECK(attributeAffects(mSinglePass, outMesh));
+
+	mAsyncGenerate = nAttr.create(NAME_ASYNC_GENERATE, "asyncGenerate", MFnNumericData::kBoolean, 0, &stat);
+	MCHECK(stat);
+	MCHECK(nAttr.setCached(true));
+	MCHECK(nAttr.setStorable(true));
+	MCHECK(nAttr.setNiceNameOverride(MString("Generate in Background")));
+	MCHECK(addAttribute(mAsyncGenerate));
+	MCHECK(attributeAffects(mAsyncGenerate, outMesh));
+
 	currentRulePkg = fAttr.create("current" + NAME_RULE_PKG, "currentRulePkg", MFnData::kString,
 	                              stringData.create(&stat2), &stat);
 	MCHECK(stat2);
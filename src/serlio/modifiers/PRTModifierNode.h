@@ -35,12 +35,36 @@ public:
 
 	static MStatus initialize();
 
+	// batch generation support (see PRTGenerateAllCommand): prepares the action from the current plug values,
+	// returns nullptr if the node cannot take part in a batch (e.g. because its rule package is not set up yet)
+	PRTModifierAction* prepareBatchGenerate();
+	void setBatchResult(const MObject& meshData, uint64_t signature);
+
 public:
 	// non-dynamic node attributes
 	static MObject rulePkg;
 	static MObject currentRulePkg;
 	static MTypeId id;
 	static MObject mRandomSeed;
+	static MObject mSinglePass;
+	static MObject mAsyncGenerate;
 
 	PRTModifierAction fPRTModifierAction;
+
+private:
+	// output mesh data generated by PRTGenerateAllCommand, consumed by the next compute if the inputs still match
+	MObject mBatchResultMesh;
+	uint64_t mBatchResultSignature = 0;
+
+	// the last applied async result (null if it is the inMesh), shown as a placeholder while generating asynchronously.
+	// it is the current outMesh data until the next result is applied, thus it is not set again.
+	MObject mLastGoodMesh;
+	// generate signature of mLastGoodMesh, a compute with the same inputs does not need to generate again
+	uint64_t mLastGoodSignature = 0;
+	bool mHasLastGoodMesh = false;
+
+	// tracks if the geometry of inMesh needs to be converted again, see setDependentsDirty()
+	bool mInMeshDirty = true;
+	// true if the outMesh holds a mesh generated by fPRTModifierAction (and not e.g. the inMesh)
+	bool mOutMeshGenerated = false;
 };
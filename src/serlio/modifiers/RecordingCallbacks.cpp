@@ -0,0 +1,251 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modifiers/RecordingCallbacks.h"
+
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+std::vector<T> copyArray(const T* data, size_t size) {
+	return (data != nullptr) ? std::vector<T>(data, data + size) : std::vector<T>();
+}
+
+std::vector<AttributeMapUPtr> copyAttributeMaps(const prt::AttributeMap** maps, size_t count) {
+	std::vector<AttributeMapUPtr> copies;
+	if (maps == nullptr)
+		return copies;
+
+	copies.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		const AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::createFromAttributeMap(maps[i]));
+		copies.emplace_back(amb->createAttributeMap());
+	}
+	return copies;
+}
+
+// aliased entries point to the data of their source entry
+template <typename T>
+std::vector<const T*> toDataPtrVec(const std::vector<std::vector<T>>& v, const std::vector<uint32_t>& sources) {
+	std::vector<const T*> ptrs;
+	ptrs.reserve(v.size());
+	for (const uint32_t s : sources)
+		ptrs.push_back(v[s].data());
+	return ptrs;
+}
+
+template <typename T>
+std::vector<size_t> toSizeVec(const std::vector<std::vector<T>>& v, const std::vector<uint32_t>& sources) {
+	std::vector<size_t> sizes;
+	sizes.reserve(v.size());
+	for (const uint32_t s : sources)
+		sizes.push_back(v[s].size());
+	return sizes;
+}
+
+} // namespace
+
+void RecordingCallbacks::addMesh(size_t isIndex, const wchar_t* name, const double* vtx, size_t vtxSize,
+                                 const double* nrm, size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                                 const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+                                 size_t normalIndicesSize, double const* const* uvs, size_t const* uvsSizes,
+                                 uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                 uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                                 const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                                 const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                 const int32_t* shapeIDs) {
+	record(RecordedMesh::Type::MESH, isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+	       vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes,
+	       uvIndices, uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void RecordingCallbacks::addMesh(size_t isIndex, const wchar_t* name, const float* vtx, size_t vtxSize,
+                                 const float* nrm, size_t nrmSize, const uint32_t* faceCounts, size_t faceCountsSize,
+                                 const uint32_t* vertexIndices, size_t vertexIndicesSize, const uint32_t* normalIndices,
+                                 size_t normalIndicesSize, float const* const* uvs, size_t const* uvsSizes,
+                                 uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                 uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                                 const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                                 const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                 const int32_t* shapeIDs) {
+	record(RecordedMesh::Type::MESH, isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+	       vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes,
+	       uvIndices, uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void RecordingCallbacks::beginMesh(size_t isIndex, const wchar_t* name, size_t vtxSize, size_t faceCountsSize,
+                                   size_t vertexIndicesSize, size_t const* uvsSizes, size_t const* uvIndicesSizes,
+                                   size_t uvSets) {
+	if (isCanceled())
+		return;
+
+	RecordedMesh m;
+	m.type = RecordedMesh::Type::BEGIN;
+	m.isIndex = isIndex;
+	m.name = (name != nullptr) ? name : L"";
+	m.totalVtxSize = vtxSize;
+	m.totalFaceCountsSize = faceCountsSize;
+	m.totalVertexIndicesSize = vertexIndicesSize;
+	m.totalUVsSizes = copyArray(uvsSizes, uvSets);
+	m.totalUVIndicesSizes = copyArray(uvIndicesSizes, uvSets);
+	mMeshes.emplace_back(std::move(m));
+}
+
+void RecordingCallbacks::appendMeshChunk(size_t isIndex, const wchar_t* name, const double* vtx, size_t vtxSize,
+                                         const double* nrm, size_t nrmSize, const uint32_t* faceCounts,
+                                         size_t faceCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                         const uint32_t* normalIndices, size_t normalIndicesSize,
+                                         double const* const* uvs, size_t const* uvsSizes,
+                                         uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                         uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                                         const uint32_t* uvSetSources, const uint32_t* faceRanges,
+                                         size_t faceRangesSize, const prt::AttributeMap** materials,
+                                         const prt::AttributeMap** reports, const int32_t* shapeIDs) {
+	record(RecordedMesh::Type::CHUNK, isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+	       vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes,
+	       uvIndices, uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void RecordingCallbacks::appendMeshChunk(size_t isIndex, const wchar_t* name, const float* vtx, size_t vtxSize,
+                                         const float* nrm, size_t nrmSize, const uint32_t* faceCounts,
+                                         size_t faceCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                         const uint32_t* normalIndices, size_t normalIndicesSize,
+                                         float const* const* uvs, size_t const* uvsSizes,
+                                         uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                         uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                                         const uint32_t* uvSetSources, const uint32_t* faceRanges,
+                                         size_t faceRangesSize, const prt::AttributeMap** materials,
+                                         const prt::AttributeMap** reports, const int32_t* shapeIDs) {
+	record(RecordedMesh::Type::CHUNK, isIndex, name, vtx, vtxSize, nrm, nrmSize, faceCounts, faceCountsSize,
+	       vertexIndices, vertexIndicesSize, normalIndices, normalIndicesSize, uvs, uvsSizes, uvCounts, uvCountsSizes,
+	       uvIndices, uvIndicesSizes, uvSets, uvSetSources, faceRanges, faceRangesSize, materials, reports, shapeIDs);
+}
+
+void RecordingCallbacks::endMesh(size_t isIndex, const wchar_t* name) {
+	if (isCanceled())
+		return;
+
+	RecordedMesh m;
+	m.type = RecordedMesh::Type::END;
+	m.isIndex = isIndex;
+	m.name = (name != nullptr) ? name : L"";
+	mMeshes.emplace_back(std::move(m));
+}
+
+template <typename T>
+void RecordingCallbacks::record(RecordedMesh::Type type, size_t isIndex, const wchar_t* name, const T* vtx,
+                                size_t vtxSize, const T* nrm, size_t nrmSize, const uint32_t* faceCounts,
+                                size_t faceCountsSize, const uint32_t* vertexIndices, size_t vertexIndicesSize,
+                                const uint32_t* normalIndices, size_t normalIndicesSize, T const* const* uvs,
+                                size_t const* uvsSizes, uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+                                uint32_t const* const* uvIndices, size_t const* uvIndicesSizes, size_t uvSets,
+                                const uint32_t* uvSetSources, const uint32_t* faceRanges, size_t faceRangesSize,
+                                const prt::AttributeMap** materials, const prt::AttributeMap** reports,
+                                const int32_t* shapeIDs) {
+	if (isCanceled())
+		return;
+
+	RecordedMesh m;
+	m.type = type;
+	m.isIndex = isIndex;
+	m.name = (name != nullptr) ? name : L"";
+	m.isFloat = std::is_same<T, float>::value;
+	VertexData<T>& vertexData = std::get<VertexData<T>>(m.vertexData);
+	vertexData.vtx = copyArray(vtx, vtxSize);
+	vertexData.nrm = copyArray(nrm, nrmSize);
+	m.faceCounts = copyArray(faceCounts, faceCountsSize);
+	m.vertexIndices = copyArray(vertexIndices, vertexIndicesSize);
+	m.normalIndices = copyArray(normalIndices, normalIndicesSize);
+
+	for (size_t uvSet = 0; uvSet < uvSets; uvSet++) {
+		const uint32_t uvSetSource = (uvSetSources != nullptr) ? uvSetSources[uvSet] : static_cast<uint32_t>(uvSet);
+		m.uvSetSources.push_back(uvSetSource);
+		if (uvSetSource != uvSet) {
+			vertexData.uvs.emplace_back();
+			m.uvCounts.emplace_back();
+			m.uvIndices.emplace_back();
+			continue;
+		}
+		vertexData.uvs.push_back(copyArray(uvs[uvSet], uvsSizes[uvSet]));
+		m.uvCounts.push_back(copyArray(uvCounts[uvSet], uvCountsSizes[uvSet]));
+		m.uvIndices.push_back(copyArray(uvIndices[uvSet], uvIndicesSizes[uvSet]));
+	}
+
+	const size_t faceRangeCount = (faceRangesSize > 0) ? faceRangesSize - 1 : 0;
+	m.faceRanges = copyArray(faceRanges, faceRangesSize);
+	m.materials = copyAttributeMaps(materials, faceRangeCount);
+	m.reports = copyAttributeMaps(reports, faceRangeCount);
+	m.shapeIDs = copyArray(shapeIDs, faceRangeCount);
+
+	mMeshes.emplace_back(std::move(m));
+}
+
+template <typename T>
+void RecordingCallbacks::replayMesh(IMayaCallbacks& target, const RecordedMesh& m) const {
+	const VertexData<T>& vertexData = std::get<VertexData<T>>(m.vertexData);
+	const std::vector<const T*> uvs = toDataPtrVec(vertexData.uvs, m.uvSetSources);
+	const std::vector<size_t> uvsSizes = toSizeVec(vertexData.uvs, m.uvSetSources);
+	const std::vector<const uint32_t*> uvCounts = toDataPtrVec(m.uvCounts, m.uvSetSources);
+	const std::vector<size_t> uvCountsSizes = toSizeVec(m.uvCounts, m.uvSetSources);
+	const std::vector<const uint32_t*> uvIndices = toDataPtrVec(m.uvIndices, m.uvSetSources);
+	const std::vector<size_t> uvIndicesSizes = toSizeVec(m.uvIndices, m.uvSetSources);
+
+	std::vector<const prt::AttributeMap*> materials;
+	for (const auto& mat : m.materials)
+		materials.push_back(mat.get());
+	std::vector<const prt::AttributeMap*> reports;
+	for (const auto& rep : m.reports)
+		reports.push_back(rep.get());
+	const prt::AttributeMap** pMaterials = materials.empty() ? nullptr : materials.data();
+	const prt::AttributeMap** pReports = reports.empty() ? nullptr : reports.data();
+
+	if (m.type == RecordedMesh::Type::CHUNK) {
+		target.appendMeshChunk(m.isIndex, m.name.c_str(), vertexData.vtx.data(), vertexData.vtx.size(),
+		                       vertexData.nrm.data(), vertexData.nrm.size(), m.faceCounts.data(), m.faceCounts.size(),
+		                       m.vertexIndices.data(), m.vertexIndices.size(), m.normalIndices.data(),
+		                       m.normalIndices.size(), uvs.data(), uvsSizes.data(), uvCounts.data(),
+		                       uvCountsSizes.data(), uvIndices.data(), uvIndicesSizes.data(), m.uvSetSources.size(),
+		                       m.uvSetSources.data(), m.faceRanges.data(), m.faceRanges.size(), pMaterials, pReports,
+		                       m.shapeIDs.data());
+	}
+	else {
+		target.addMesh(m.isIndex, m.name.c_str(), vertexData.vtx.data(), vertexData.vtx.size(), vertexData.nrm.data(),
+		               vertexData.nrm.size(), m.faceCounts.data(), m.faceCounts.size(), m.vertexIndices.data(),
+		               m.vertexIndices.size(), m.normalIndices.data(), m.normalIndices.size(), uvs.data(),
+		               uvsSizes.data(), uvCounts.data(), uvCountsSizes.data(), uvIndices.data(), uvIndicesSizes.data(),
+		               m.uvSetSources.size(), m.uvSetSources.data(), m.faceRanges.data(), m.faceRanges.size(),
+		               pMaterials, pReports, m.shapeIDs.data());
+	}
+}
+
+void RecordingCallbacks::replay(IMayaCallbacks& target) const {
+	for (const RecordedMesh& m : mMeshes) {
+		if (m.type == RecordedMesh::Type::BEGIN)
+			target.beginMesh(m.isIndex, m.name.c_str(), m.totalVtxSize, m.totalFaceCountsSize,
+			                 m.totalVertexIndicesSize, m.totalUVsSizes.data(), m.totalUVIndicesSizes.data(),
+			                 m.totalUVsSizes.size());
+		else if (m.type == RecordedMesh::Type::END)
+			target.endMesh(m.isIndex, m.name.c_str());
+		else if (m.isFloat)
+			replayMesh<float>(target, m);
+		else
+			replayMesh<double>(target, m);
+	}
+}
@@ -0,0 +1,264 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "encoder/IMayaCallbacks.h"
+
+#include "utils/LogHandler.h"
+#include "utils/Utilities.h"
+
+#include <atomic>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Records the meshes produced by the maya encoder, so they can be replayed into MayaCallbacks later.
+// This allows to run prt::generate on a worker thread: the maya API must only be used on the main thread.
+// Attribute values (e.g. of the AttributeEvalEncoder) are collected, see createAttributeMap().
+class RecordingCallbacks : public IMayaCallbacks {
+public:
+	// canceled: optional flag to abort the generate call from another thread
+	explicit RecordingCallbacks(const std::atomic<bool>* canceled = nullptr) : mCanceled(canceled) {}
+
+	// prt::Callbacks interface
+	prt::Status generateError(size_t /*isIndex*/, prt::Status /*status*/, const wchar_t* message) override {
+		LOG_ERR << "GENERATE ERROR: " << message;
+		return getStatus();
+	}
+	prt::Status assetError(size_t /*isIndex*/, prt::CGAErrorLevel /*level*/, const wchar_t* /*key*/,
+	                       const wchar_t* /*uri*/, const wchar_t* message) override {
+		LOG_ERR << "ASSET ERROR: " << message;
+		return getStatus();
+	}
+	prt::Status cgaError(size_t /*isIndex*/, int32_t /*shapeID*/, prt::CGAErrorLevel /*level*/, int32_t /*methodId*/,
+	                     int32_t /*pc*/, const wchar_t* message) override {
+		LOG_ERR << "CGA ERROR: " << message;
+		return getStatus();
+	}
+	prt::Status cgaPrint(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* txt) override {
+		LOG_INF << "CGA PRINT: " << txt;
+		return getStatus();
+	}
+	prt::Status cgaReportBool(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
+	                          bool /*value*/) override {
+		return getStatus();
+	}
+	prt::Status cgaReportFloat(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
+	                           double /*value*/) override {
+		return getStatus();
+	}
+	prt::Status cgaReportString(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* /*key*/,
+	                            const wchar_t* /*value*/) override {
+		return getStatus();
+	}
+	prt::Status attrBool(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, bool value) override {
+		mAttributeMapBuilder->setBool(key, value);
+		return getStatus();
+	}
+	prt::Status attrFloat(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, double value) override {
+		mAttributeMapBuilder->setFloat(key, value);
+		return getStatus();
+	}
+	prt::Status attrString(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+	                       const wchar_t* value) override {
+		mAttributeMapBuilder->setString(key, value);
+		return getStatus();
+	}
+
+// PRT version >= 2.1
+#if PRT_VERSION_GTE(2, 1)
+
+	prt::Status attrBoolArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, const bool* values,
+	                          size_t size) override {
+		mAttributeMapBuilder->setBoolArray(key, values, size);
+		return getStatus();
+	}
+	prt::Status attrFloatArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key, const double* values,
+	                           size_t size) override {
+		mAttributeMapBuilder->setFloatArray(key, values, size);
+		return getStatus();
+	}
+	prt::Status attrStringArray(size_t /*isIndex*/, int32_t /*shapeID*/, const wchar_t* key,
+	                            const wchar_t* const* values, size_t size) override {
+		mAttributeMapBuilder->setStringArray(key, values, size);
+		return getStatus();
+	}
+
+#endif // PRT version >= 2.1
+
+public:
+	// clang-format off
+	void addMesh(size_t isIndex, const wchar_t* name,
+	                     const double* vtx, size_t vtxSize,
+	                     const double* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     double const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override;
+	void addMesh(size_t isIndex, const wchar_t* name,
+	             const float* vtx, size_t vtxSize,
+	             const float* nrm, size_t nrmSize,
+	             const uint32_t* faceCounts, size_t faceCountsSize,
+	             const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	             const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	             float const* const* uvs, size_t const* uvsSizes,
+	             uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	             uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	             size_t uvSets, const uint32_t* uvSetSources,
+
+	             const uint32_t* faceRanges, size_t faceRangesSize,
+	             const prt::AttributeMap** materials,
+	             const prt::AttributeMap** reports,
+	             const int32_t* shapeIDs) override;
+
+	void beginMesh(size_t isIndex, const wchar_t* name, size_t vtxSize, size_t faceCountsSize,
+	               size_t vertexIndicesSize, size_t const* uvsSizes, size_t const* uvIndicesSizes,
+	               size_t uvSets) override;
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const double* vtx, size_t vtxSize,
+	                     const double* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     double const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override;
+	void appendMeshChunk(size_t isIndex, const wchar_t* name,
+	                     const float* vtx, size_t vtxSize,
+	                     const float* nrm, size_t nrmSize,
+	                     const uint32_t* faceCounts, size_t faceCountsSize,
+	                     const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	                     const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	                     float const* const* uvs, size_t const* uvsSizes,
+	                     uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	                     uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	                     size_t uvSets, const uint32_t* uvSetSources,
+
+	                     const uint32_t* faceRanges, size_t faceRangesSize,
+	                     const prt::AttributeMap** materials,
+	                     const prt::AttributeMap** reports,
+	                     const int32_t* shapeIDs) override;
+	void endMesh(size_t isIndex, const wchar_t* name) override;
+	// clang-format on
+
+	bool isCanceled() const override {
+		return (mCanceled != nullptr) && mCanceled->load();
+	}
+
+	// forwards the recorded meshes to the target callbacks (in the order they have been added)
+	void replay(IMayaCallbacks& target) const;
+
+	bool empty() const {
+		return mMeshes.empty();
+	}
+
+	// the recorded attribute values
+	AttributeMapUPtr createAttributeMap() const {
+		return AttributeMapUPtr(mAttributeMapBuilder->createAttributeMap());
+	}
+
+private:
+	// a non-OK status tells PRT to stop generating
+	prt::Status getStatus() const {
+		return isCanceled() ? prt::STATUS_CANCELED : prt::STATUS_OK;
+	}
+
+	const std::atomic<bool>* mCanceled;
+
+	template <typename T>
+	struct VertexData {
+		std::vector<T> vtx;
+		std::vector<T> nrm;
+		std::vector<std::vector<T>> uvs;
+	};
+
+	// a complete mesh (addMesh) or one of the calls which stream a mesh in chunks
+	struct RecordedMesh {
+		enum class Type { MESH, BEGIN, CHUNK, END };
+		Type type = Type::MESH;
+
+		// only for BEGIN, see IMayaCallbacks::beginMesh
+		size_t totalVtxSize = 0;
+		size_t totalFaceCountsSize = 0;
+		size_t totalVertexIndicesSize = 0;
+		std::vector<size_t> totalUVsSizes; // per uv set
+		std::vector<size_t> totalUVIndicesSizes;
+
+		size_t isIndex = 0;
+		std::wstring name;
+		bool isFloat = false; // selects the filled vertex data, see EO_FLOAT_VERTEX_DATA
+		std::tuple<VertexData<double>, VertexData<float>> vertexData;
+		std::vector<uint32_t> faceCounts;
+		std::vector<uint32_t> vertexIndices;
+		std::vector<uint32_t> normalIndices;
+		std::vector<std::vector<uint32_t>> uvCounts;
+		std::vector<std::vector<uint32_t>> uvIndices;
+		std::vector<uint32_t> uvSetSources; // aliased uv sets are not copied
+		std::vector<uint32_t> faceRanges;
+		std::vector<AttributeMapUPtr> materials;
+		std::vector<AttributeMapUPtr> reports;
+		std::vector<int32_t> shapeIDs;
+	};
+
+	// clang-format off
+	template <typename T>
+	void record(RecordedMesh::Type type,
+	            size_t isIndex, const wchar_t* name,
+	            const T* vtx, size_t vtxSize,
+	            const T* nrm, size_t nrmSize,
+	            const uint32_t* faceCounts, size_t faceCountsSize,
+	            const uint32_t* vertexIndices, size_t vertexIndicesSize,
+	            const uint32_t* normalIndices, size_t normalIndicesSize,
+
+	            T const* const* uvs, size_t const* uvsSizes,
+	            uint32_t const* const* uvCounts, size_t const* uvCountsSizes,
+	            uint32_t const* const* uvIndices, size_t const* uvIndicesSizes,
+	            size_t uvSets, const uint32_t* uvSetSources,
+
+	            const uint32_t* faceRanges, size_t faceRangesSize,
+	            const prt::AttributeMap** materials,
+	            const prt::AttributeMap** reports,
+	            const int32_t* shapeIDs);
+	// clang-format on
+
+	template <typename T>
+	void replayMesh(IMayaCallbacks& target, const RecordedMesh& m) const;
+
+	std::vector<RecordedMesh> mMeshes;
+	AttributeMapBuilderUPtr mAttributeMapBuilder{prt::AttributeMapBuilder::create()};
+};
@@ -20,21 +20,36 @@
 #include "serlioPlugin.h"
 #include "PRTContext.h"
 
+#include "modifiers/PRTCacheCommand.h"
+#include "modifiers/PRTGenerateAllCommand.h"
 #include "modifiers/PRTModifierCommand.h"
 #include "modifiers/PRTModifierNode.h"
 
 #include "materials/ArnoldMaterialNode.h"
 #include "materials/StingrayMaterialNode.h"
 
+#include "utils/LogHandler.h"
+#include "utils/MItDependencyNodesWrapper.h"
 #include "utils/MayaUtilities.h"
 
+#include "maya/MFnDependencyNode.h"
 #include "maya/MFnPlugin.h"
 #include "maya/MGlobal.h"
+#include "maya/MItDependencyNodes.h"
+#include "maya/MPlug.h"
 #include "maya/MSceneMessage.h"
 #include "maya/MStatus.h"
 #include "maya/MString.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 namespace {
 constexpr bool DBG = false;
@@ -43,11 +58,86 @@ constexpr const char* NODE_MODIFIER = "serlio";
 constexpr const char* NODE_MATERIAL = "serlioMaterial";
 constexpr const char* NODE_ARNOLD_MATERIAL = "serlioArnoldMaterial";
 constexpr const char* CMD_ASSIGN = "serlioAssign";
+constexpr const char* CMD_GENERATE_ALL = "serlioGenerateAll";
+constexpr const char* CMD_CACHE = "serlioCache";
 constexpr const char* MEL_PROC_CREATE_UI = "serlioCreateUI";
 constexpr const char* MEL_PROC_DELETE_UI = "serlioDeleteUI";
 constexpr const char* SERLIO_VENDOR = "Esri R&D Center Zurich";
 
 std::once_flag callbackRegisterFlag;
+MCallbackId afterOpenCallbackId = 0;
+
+// loads a rule package into the caches: resolve map, rule file info (and the decoded rule file in the PRT cache) and
+// the rule attributes
+void prefetchRulePackage(const std::wstring& rulePkg) {
+	PRTContext::get().mResolveMapCache->getRulePackageInfo(rulePkg, PRTContext::get().theCache.get());
+}
+
+// the rule packages of a scene, processed by a few workers
+struct RulePackagePrefetch {
+	std::vector<std::wstring> rulePkgs;
+	std::atomic<size_t> nextRulePkg{0};
+	std::atomic<size_t> runningWorkers{0};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	void work() {
+		for (size_t i = nextRulePkg++; i < rulePkgs.size(); i = nextRulePkg++)
+			prefetchRulePackage(rulePkgs[i]);
+
+		if (--runningWorkers == 0) {
+			const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			        std::chrono::steady_clock::now() - start);
+			LOG_INF << "prefetched " << rulePkgs.size() << " rule packages in " << duration.count() << "ms";
+		}
+	}
+};
+
+// the prefetch workers run in the background, they must be done before PRT goes away (see uninitializePlugin)
+std::vector<std::future<void>> prefetchWorkers;
+
+void waitForPrefetchWorkers() {
+	for (auto& w : prefetchWorkers)
+		w.wait();
+	prefetchWorkers.clear();
+}
+
+// the nodes of a freshly opened scene have not been computed yet, warm up the caches for their rule packages in
+// the background instead of letting the (serial) first compute of each node load them one after the other. The
+// scene open does not wait for it: the compute of a node whose rule package is still being prefetched waits for the
+// pending lookup in the ResolveMapCache.
+void prefetchRulePackagesOfScene(void*) {
+	if (!PRTContext::get().isAlive())
+		return;
+
+	std::set<std::wstring> uniqueRulePkgs;
+	MStatus status;
+	MItDependencyNodes nodeIt(MFn::kPluginDependNode, &status);
+	MCHECK(status);
+	for (const auto& nodeObj : MItDependencyNodesWrapper(nodeIt)) {
+		MFnDependencyNode fNode(nodeObj);
+		if (fNode.typeId() != PRTModifierNode::id)
+			continue;
+
+		MString rulePkg;
+		MCHECK(MPlug(nodeObj, PRTModifierNode::rulePkg).getValue(rulePkg));
+		if (rulePkg.length() > 0)
+			uniqueRulePkgs.emplace(rulePkg.asWChar());
+	}
+	if (uniqueRulePkgs.empty())
+		return;
+
+	// keep the number of threads bounded, also if scenes are opened in quick succession
+	waitForPrefetchWorkers();
+
+	// a few workers process all rule packages, a scene might reference many of them
+	auto prefetch = std::make_shared<RulePackagePrefetch>();
+	prefetch->rulePkgs.assign(uniqueRulePkgs.begin(), uniqueRulePkgs.end());
+	const size_t numWorkers =
+	        std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), prefetch->rulePkgs.size());
+	prefetch->runningWorkers = numWorkers;
+	for (size_t w = 0; w < numWorkers; w++)
+		prefetchWorkers.emplace_back(std::async(std::launch::async, [prefetch]() { prefetch->work(); }));
+}
 
 } // namespace
 
@@ -71,6 +161,12 @@ MStatus initializePlugin(MObject obj) {
 	auto createModifierCommand = []() { return (void*)new PRTModifierCommand(); };
 	MCHECK(plugin.registerCommand(CMD_ASSIGN, createModifierCommand));
 
+	auto createGenerateAllCommand = []() { return (void*)new PRTGenerateAllCommand(); };
+	MCHECK(plugin.registerCommand(CMD_GENERATE_ALL, createGenerateAllCommand));
+
+	auto createCacheCommand = []() { return (void*)new PRTCacheCommand(); };
+	MCHECK(plugin.registerCommand(CMD_CACHE, createCacheCommand, PRTCacheCommand::createSyntax));
+
 	auto createModifierNode = []() { return (void*)new PRTModifierNode(); };
 	MCHECK(plugin.registerNode(NODE_MODIFIER, PRTModifierNode::id, createModifierNode, PRTModifierNode::initialize));
 
@@ -84,6 +180,11 @@ MStatus initializePlugin(MObject obj) {
 
 	MCHECK(plugin.registerUI(MEL_PROC_CREATE_UI, MEL_PROC_DELETE_UI));
 
+	MStatus callbackStatus = MStatus::kFailure;
+	afterOpenCallbackId =
+	        MSceneMessage::addCallback(MSceneMessage::kAfterOpen, prefetchRulePackagesOfScene, nullptr, &callbackStatus);
+	MCHECK(callbackStatus);
+
 	return MStatus::kSuccess;
 }
 
@@ -93,10 +194,15 @@ MStatus uninitializePlugin(MObject obj) {
 	// * maya may unload/load serlio
 	// * PRT only supports initializing once per process life time
 
+	waitForPrefetchWorkers();
+
 	MStatus status;
 	if (obj != MObject::kNullObj) { // TODO
 		MFnPlugin plugin(obj);
+		MCHECK(MMessage::removeCallback(afterOpenCallbackId));
 		MCHECK(plugin.deregisterCommand(CMD_ASSIGN));
+		MCHECK(plugin.deregisterCommand(CMD_GENERATE_ALL));
+		MCHECK(plugin.deregisterCommand(CMD_CACHE));
 		MCHECK(plugin.deregisterNode(PRTModifierNode::id));
 		MCHECK(plugin.deregisterNode(StingrayMaterialNode::id));
 		MCHECK(plugin.deregisterNode(ArnoldMaterialNode::id));
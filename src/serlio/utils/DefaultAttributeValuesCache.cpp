@@ -0,0 +1,107 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/DefaultAttributeValuesCache.h"
+#include "utils/LogHandler.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+
+constexpr bool DBG = false;
+
+} // namespace
+
+constexpr size_t DefaultAttributeValuesCache::MAX_ENTRIES;
+
+bool DefaultAttributeValuesCache::Key::operator<(const Key& other) const {
+	return std::tie(geometryHash, seed, rpkTimeStamp, rpk, ruleFile, startRule) <
+	       std::tie(other.geometryHash, other.seed, other.rpkTimeStamp, other.rpk, other.ruleFile, other.startRule);
+}
+
+AttributeMapSPtr DefaultAttributeValuesCache::get(const Key& key, const ValueFunc& valueFunc) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const auto it = mCache.find(key);
+		if (it != mCache.end()) {
+			mHitCount++;
+			it->second.lastAccess = ++mAccessCounter;
+			return it->second.defaultValues;
+		}
+		mMissCount++;
+	}
+
+	if (DBG)
+		LOG_DBG << "evaluating default attribute values for rpk " << key.rpk << ", geometry hash " << key.geometryHash;
+
+	// note: concurrent misses for the same key will evaluate twice, the first result wins
+	AttributeMapSPtr defaultValues(valueFunc().release(), PRTDestroyer());
+	return put(key, defaultValues);
+}
+
+AttributeMapSPtr DefaultAttributeValuesCache::put(const Key& key, const AttributeMapSPtr& defaultValues) {
+	if (!defaultValues)
+		return defaultValues;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	evictOutdated(key);
+	Entry& entry = mCache.emplace(key, Entry{defaultValues, 0}).first->second;
+	entry.lastAccess = ++mAccessCounter;
+	return entry.defaultValues;
+}
+
+// drop all entries of a rule package which has been changed on disk, plus the least recently used entries if we are
+// at capacity
+void DefaultAttributeValuesCache::evictOutdated(const Key& key) {
+	for (auto it = mCache.begin(); it != mCache.end();) {
+		if (it->first.rpk == key.rpk && it->first.rpkTimeStamp != key.rpkTimeStamp)
+			it = mCache.erase(it);
+		else
+			++it;
+	}
+	if (mCache.find(key) != mCache.end())
+		return; // no new entry
+	while (mCache.size() >= MAX_ENTRIES) {
+		const auto lru = std::min_element(mCache.begin(), mCache.end(), [](const auto& a, const auto& b) {
+			return a.second.lastAccess < b.second.lastAccess;
+		});
+		mCache.erase(lru);
+	}
+}
+
+void DefaultAttributeValuesCache::clear() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCache.clear();
+}
+
+size_t DefaultAttributeValuesCache::size() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCache.size();
+}
+
+size_t DefaultAttributeValuesCache::getHitCount() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHitCount;
+}
+
+size_t DefaultAttributeValuesCache::getMissCount() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMissCount;
+}
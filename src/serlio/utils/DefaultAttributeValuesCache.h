@@ -0,0 +1,82 @@
+/**
+ * Serlio - Esri CityEngine Plugin for Autodesk Maya
+ *
+ * See https://github.com/esri/serlio for build and usage instructions.
+ *
+ * Copyright (c) 2012-2019 Esri R&D Center Zurich
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Utilities.h"
+
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+
+// caches the result of the (expensive) attribute evaluation generate call for a given rule and initial shape
+class DefaultAttributeValuesCache {
+public:
+	struct Key {
+		std::wstring rpk;
+		time_t rpkTimeStamp;
+		std::wstring ruleFile;
+		std::wstring startRule;
+		int32_t seed;
+		uint64_t geometryHash;
+
+		bool operator<(const Key& other) const;
+	};
+
+	using ValueFunc = std::function<AttributeMapUPtr()>;
+
+	// safety net against unbounded growth (e.g. if the input geometry is animated), the least recently used entries
+	// are evicted first
+	static constexpr size_t MAX_ENTRIES = 1024;
+
+	DefaultAttributeValuesCache() = default;
+	DefaultAttributeValuesCache(const DefaultAttributeValuesCache&) = delete;
+	DefaultAttributeValuesCache(DefaultAttributeValuesCache&&) = delete;
+	DefaultAttributeValuesCache& operator=(DefaultAttributeValuesCache const&) = delete;
+	DefaultAttributeValuesCache& operator=(DefaultAttributeValuesCache&&) = delete;
+
+	// returns the cached default values or calls valueFunc on a miss (without holding the cache lock)
+	AttributeMapSPtr get(const Key& key, const ValueFunc& valueFunc);
+	// stores values which have been evaluated elsewhere, e.g. as part of a regular generate call
+	AttributeMapSPtr put(const Key& key, const AttributeMapSPtr& defaultValues);
+	void clear();
+
+	size_t size() const;
+	size_t getHitCount() const;
+	size_t getMissCount() const;
+
+private:
+	void evictOutdated(const Key& key);
+
+	struct Entry {
+		AttributeMapSPtr defaultValues;
+		uint64_t lastAccess; // see mAccessCounter
+	};
+	using Cache = std::map<Key, Entry>;
+	Cache mCache;
+	uint64_t mAccessCounter = 0;
+
+	size_t mHitCount = 0;
+	size_t mMissCount = 0;
+
+	mutable std::mutex mMutex;
+};
+
+using DefaultAttributeValuesCacheUPtr = std::unique_ptr<DefaultAttributeValuesCache>;
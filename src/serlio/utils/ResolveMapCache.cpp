@@ -21,7 +21,12 @@
 #include "utils/LogHandler.h"
 #include "utils/Utilities.h"
 
+#include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <mutex>
+#include <sstream>
+#include <thread>
 
 namespace {
 
@@ -29,20 +34,269 @@ constexpr bool DBG = false;
 
 const ResolveMapSPtr RESOLVE_MAP_NONE;
 const ResolveMapCache::LookupResult LOOKUP_FAILURE = {RESOLVE_MAP_NONE, ResolveMapCache::CacheStatus::MISS};
-std::mutex resolveMapCacheMutex;
+
+// blocks if the RPK is still being unpacked by another lookup
+ResolveMapCache::LookupResult waitForCachedResolveMap(const std::shared_future<ResolveMapSPtr>& resolveMap) {
+	const ResolveMapSPtr& rm = resolveMap.get();
+	if (!rm)
+		return LOOKUP_FAILURE;
+	return {rm, ResolveMapCache::CacheStatus::HIT};
+}
+
+std::wstring toHexString(uint64_t value) {
+	std::wostringstream wstr;
+	wstr << std::hex << std::setw(16) << std::setfill(L'0') << value;
+	return wstr.str();
+}
+
+void removeDirectory(const std::wstring& path) {
+	const auto start = std::chrono::steady_clock::now();
+	prtu::remove_all(path);
+	const auto duration =
+	        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	LOG_INF << "Removed RPK unpack directory " << path << " in " << duration.count() << "ms";
+}
+
+ResolveMapCache::RulePackageInfoSPtr createRulePackageInfo(const ResolveMapSPtr& resolveMap, prt::Cache* cache) {
+	auto info = std::make_shared<ResolveMapCache::RulePackageInfo>();
+
+	info->ruleFile = prtu::getRuleFileEntry(resolveMap);
+	const wchar_t* ruleFileURI = info->ruleFile.empty() ? nullptr : resolveMap->getString(info->ruleFile.c_str());
+	if (ruleFileURI == nullptr)
+		return {};
+
+	prt::Status infoStatus = prt::STATUS_UNSPECIFIED_ERROR;
+	info->ruleFileInfo.reset(prt::createRuleFileInfo(ruleFileURI, cache, &infoStatus));
+	if (!info->ruleFileInfo || infoStatus != prt::STATUS_OK)
+		return {};
+
+	info->startRule = prtu::detectStartRule(info->ruleFileInfo);
+	info->ruleAttributes = getRuleAttributes(info->ruleFile, info->ruleFileInfo.get());
+	sortRuleAttributes(info->ruleAttributes);
+
+	info->mayaFullNameIndex.reserve(info->ruleAttributes.size());
+	for (size_t i = 0; i < info->ruleAttributes.size(); i++)
+		info->mayaFullNameIndex.emplace(info->ruleAttributes[i].mayaFullName, i);
+	return info;
+}
+
+// how long to wait for another process to unpack an RPK into the persistent unpack path, afterwards the RPK is
+// unpacked into our own unpack path
+constexpr std::chrono::seconds PERSISTENT_LOCK_TIMEOUT{30};
+// a lock of another host is considered stale after this time, we can not check if its process is still running
+constexpr std::chrono::minutes PERSISTENT_LOCK_MAX_AGE{10};
+
+// a lock file contains "<pid>@<host>" of the process which holds it
+std::wstring getLockOwner() {
+	return std::to_wstring(prtu::getProcessId()) + L'@' + prtu::getHostName();
+}
+
+bool createLock(const std::wstring& lockPath) {
+	if (!prtu::createFileExclusively(lockPath))
+		return false;
+#ifdef _WIN32
+	std::ofstream out(lockPath);
+#else
+	std::ofstream out(prtu::toOSNarrowFromUTF16(lockPath));
+#endif
+	out << prtu::toUTF8FromUTF16(getLockOwner());
+	return true;
+}
+
+std::wstring readLockOwner(const std::wstring& lockPath) {
+#ifdef _WIN32
+	std::ifstream in(lockPath);
+#else
+	std::ifstream in(prtu::toOSNarrowFromUTF16(lockPath));
+#endif
+	std::string owner;
+	std::getline(in, owner);
+	return prtu::toUTF16FromUTF8(owner);
+}
+
+// i.e. left behind by a process which crashed or has been killed while unpacking
+bool isStaleLock(const std::wstring& lockPath, const std::wstring& owner) {
+	const size_t at = owner.find(L'@');
+	if (at != std::wstring::npos && at > 0 && owner.substr(at + 1) == prtu::getHostName()) {
+		const uint64_t pid = std::wcstoull(owner.c_str(), nullptr, 10);
+		return !prtu::isProcessRunning(pid);
+	}
+
+	// the owner is on another host or has not written the lock yet
+	const time_t lockTime = prtu::getFileModificationTime(lockPath);
+	const auto maxAge = std::chrono::duration_cast<std::chrono::seconds>(PERSISTENT_LOCK_MAX_AGE);
+	return lockTime != -1 && std::difftime(std::time(nullptr), lockTime) > static_cast<double>(maxAge.count());
+}
+
+// the index lists the keys and values of a resolve map, one "key<tab>value" line per entry (in UTF-8)
+ResolveMapSPtr readResolveMapIndex(const std::wstring& indexPath) {
+#ifdef _WIN32
+	std::ifstream in(indexPath);
+#else
+	std::ifstream in(prtu::toOSNarrowFromUTF16(indexPath));
+#endif
+	if (!in)
+		return {};
+
+	ResolveMapBuilderUPtr resolveMapBuilder(prt::ResolveMapBuilder::create());
+	std::string line;
+	while (std::getline(in, line)) {
+		const size_t tab = line.find('\t');
+		if (tab == std::string::npos)
+			return {};
+		const std::wstring key = prtu::toUTF16FromUTF8(line.substr(0, tab));
+		const std::wstring value = prtu::toUTF16FromUTF8(line.substr(tab + 1));
+		resolveMapBuilder->addEntry(key.c_str(), value.c_str());
+	}
+
+	prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+	ResolveMapSPtr resolveMap(resolveMapBuilder->createResolveMap(&status), PRTDestroyer());
+	if (status != prt::STATUS_OK)
+		return {};
+	return resolveMap;
+}
+
+// writes to a temporary file first, the index must not be visible until it is complete
+bool writeResolveMapIndex(const prt::ResolveMap& resolveMap, const std::wstring& indexPath) {
+	const std::wstring tmpIndexPath = indexPath + L".tmp";
+	{
+#ifdef _WIN32
+		std::ofstream out(tmpIndexPath);
+#else
+		std::ofstream out(prtu::toOSNarrowFromUTF16(tmpIndexPath));
+#endif
+		size_t keyCount = 0;
+		const wchar_t* const* keys = resolveMap.getKeys(&keyCount);
+		for (size_t k = 0; k < keyCount; k++) {
+			const wchar_t* value = resolveMap.getString(keys[k]);
+			if (value != nullptr)
+				out << prtu::toUTF8FromUTF16(keys[k]) << '\t' << prtu::toUTF8FromUTF16(value) << '\n';
+		}
+		if (!out)
+			return false;
+	}
+	return prtu::renameFile(tmpIndexPath, indexPath);
+}
+
+// layout of the persistent unpack path, per RPK content hash:
+//   <hash>/       the unpacked RPK
+//   <hash>.index  see readResolveMapIndex(), written last and therefore marks <hash>/ as complete
+//   <hash>.lock   exists while a process is unpacking the RPK, see getLockOwner()
+// returns an empty pointer if the RPK could not be unpacked or if another process holds the lock for too long
+ResolveMapSPtr getPersistentResolveMap(const std::wstring& rpkURI, const std::wstring& unpackPath) {
+	const std::wstring indexPath = unpackPath + L".index";
+	const std::wstring lockPath = unpackPath + L".lock";
+
+	const auto deadline = std::chrono::steady_clock::now() + PERSISTENT_LOCK_TIMEOUT;
+	while (!createLock(lockPath)) {
+		if (ResolveMapSPtr resolveMap = readResolveMapIndex(indexPath))
+			return resolveMap;
+
+		// re-check the owner right before the removal, another process might have taken over meanwhile
+		const std::wstring owner = readLockOwner(lockPath);
+		if (isStaleLock(lockPath, owner) && readLockOwner(lockPath) == owner) {
+			LOG_WRN << "removing stale lock " << lockPath << " of " << owner;
+			prtu::removeFile(lockPath);
+		}
+		if (std::chrono::steady_clock::now() > deadline) {
+			LOG_WRN << "timeout while waiting for " << lockPath << " of " << owner;
+			return {};
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	// another process might have completed the unpacking before we got the lock
+	ResolveMapSPtr resolveMap = readResolveMapIndex(indexPath);
+	if (!resolveMap) {
+		prtu::remove_all(unpackPath); // leftovers of an interrupted process
+
+		prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
+		resolveMap.reset(prt::createResolveMap(rpkURI.c_str(), unpackPath.c_str(), &status), PRTDestroyer());
+		if (status != prt::STATUS_OK)
+			resolveMap.reset();
+		else if (!writeResolveMapIndex(*resolveMap, indexPath))
+			LOG_WRN << "failed to write " << indexPath << ", the RPK will be unpacked again next time";
+
+		if (DBG)
+			LOG_DBG << "Unpacked RPK to persistent unpack directory " << unpackPath;
+	}
+	else if (DBG)
+		LOG_DBG << "Reusing persistent unpack directory " << unpackPath;
+
+	prtu::removeFile(lockPath);
+	return resolveMap;
+}
 
 } // namespace
 
+constexpr std::chrono::milliseconds ResolveMapCache::DEFAULT_REVALIDATION_INTERVAL;
+constexpr size_t ResolveMapCache::DEFAULT_MAX_ENTRIES;
+constexpr uint64_t ResolveMapCache::DEFAULT_MAX_UNPACKED_BYTES;
+
+void ResolveMapCache::setRevalidationInterval(std::chrono::milliseconds interval) {
+	std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+	mRevalidationInterval = interval;
+}
+
+void ResolveMapCache::setLimits(size_t maxEntries, uint64_t maxUnpackedBytes) {
+	EvictedResolveMaps evicted;
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		mMaxEntries = maxEntries;
+		mMaxUnpackedBytes = maxUnpackedBytes;
+		evictLeastRecentlyUsed(evicted);
+	}
+	notifyEvicted(evicted);
+}
+
+void ResolveMapCache::setEvictionCallback(EvictionCallback callback) {
+	std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+	mEvictionCallback = std::move(callback);
+}
+
+ResolveMapCache::Stats ResolveMapCache::getStats() {
+	std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+	Stats stats;
+	stats.entries = mCache.size();
+	stats.unpackedBytes = mUnpackedBytes;
+	stats.hits = mHits;
+	stats.misses = mMisses;
+	stats.evictions = mEvictions;
+	return stats;
+}
+
+time_t ResolveMapCache::getTimeStamp(const std::wstring& rpk) {
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mRPKPaths.find(rpk);
+		if (it != mRPKPaths.end())
+			return it->second.mTimeStamp;
+	}
+	return prtu::getFileModificationTime(rpk);
+}
+
 ResolveMapCache::~ResolveMapCache() {
+	for (auto& removal : mPendingRemovals)
+		removal.wait();
+
+	// unpack directories in the persistent unpack path are kept on purpose
 	if (!mRPKUnpackPath.empty())
-		prtu::remove_all(mRPKUnpackPath);
-	if (DBG)
-		LOG_DBG << "Removed RPK unpack directory";
+		removeDirectory(mRPKUnpackPath);
 }
 
 ResolveMapCache::LookupResult ResolveMapCache::get(const std::wstring& rpk) {
+	const auto now = std::chrono::steady_clock::now();
 
-	std::lock_guard<std::mutex> lock(resolveMapCacheMutex);
+	// fast path: the RPK has been validated recently, only wait if it is still being unpacked
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mRPKPaths.find(rpk);
+		if (it != mRPKPaths.end() && now - it->second.mLastValidation < mRevalidationInterval) {
+			const std::shared_future<ResolveMapSPtr> resolveMap = access(mCache.at(it->second.mContentHash));
+			lock.unlock();
+			return waitForCachedResolveMap(resolveMap);
+		}
+	}
 
 	const time_t timeStamp = prtu::getFileModificationTime(rpk);
 	if (DBG)
@@ -52,44 +306,268 @@ ResolveMapCache::LookupResult ResolveMapCache::get(const std::wstring& rpk) {
 	if (timeStamp == -1)
 		return LOOKUP_FAILURE;
 
-	CacheStatus cs = CacheStatus::HIT;
-	auto it = mCache.find(rpk);
-	if (it != mCache.end()) {
-		if (DBG)
-			LOG_DBG << "rpk: cache timestamp: " << it->second.mTimeStamp;
-		if (it->second.mTimeStamp != timeStamp) {
-			mCache.erase(it);
-			std::wstring filename = prtu::filename(rpk);
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mRPKPaths.find(rpk);
+		if (it != mRPKPaths.end() && it->second.mTimeStamp == timeStamp) {
+			it->second.mLastValidation = now;
+			const std::shared_future<ResolveMapSPtr> resolveMap = access(mCache.at(it->second.mContentHash));
+			lock.unlock();
+			return waitForCachedResolveMap(resolveMap);
+		}
+	}
+
+	// new or modified RPK, identify it by its content
+	uint64_t contentHash = 0;
+	if (!prtu::getFileContentHash(rpk, contentHash))
+		return LOOKUP_FAILURE;
+
+	std::promise<ResolveMapSPtr> resolveMapPromise;
+	std::wstring unpackPath;
+	EvictedResolveMaps replaced;
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
 
-			if (!mRPKUnpackPath.empty() && !filename.empty())
-				prtu::remove_all(mRPKUnpackPath + prtu::getDirSeparator<std::wstring>() + prtu::filename(rpk));
+		// another thread might have looked up the RPK meanwhile
+		auto pathIt = mRPKPaths.find(rpk);
+		if (pathIt != mRPKPaths.end()) {
+			if (DBG)
+				LOG_DBG << "rpk: cache timestamp: " << pathIt->second.mTimeStamp;
+			if (pathIt->second.mContentHash == contentHash) { // e.g. touched but not modified
+				pathIt->second.mTimeStamp = timeStamp;
+				pathIt->second.mLastValidation = now;
+				const std::shared_future<ResolveMapSPtr> resolveMap = access(mCache.at(contentHash));
+				lock.unlock();
+				return waitForCachedResolveMap(resolveMap);
+			}
 
 			if (DBG)
 				LOG_DBG << "RPK change detected, forcing reload and clearing cache for " << rpk;
-			cs = CacheStatus::MISS;
+			releaseEntry(pathIt->second.mContentHash, replaced);
+			mRPKPaths.erase(pathIt);
 		}
-	}
-	else
-		cs = CacheStatus::MISS;
+		mRPKPaths.emplace(rpk, RPKPathEntry{contentHash, timeStamp, now});
 
-	if (cs == CacheStatus::MISS) {
+		// the same RPK might already be known from another path
+		auto cacheIt = mCache.find(contentHash);
+		if (cacheIt != mCache.end()) {
+			if (DBG)
+				LOG_DBG << "rpk: sharing resolve map of identical RPK for " << rpk;
+			cacheIt->second.mRefCount++;
+			const std::shared_future<ResolveMapSPtr> resolveMap = access(cacheIt->second);
+			lock.unlock();
+			notifyEvicted(replaced);
+			return waitForCachedResolveMap(resolveMap);
+		}
 
-		const auto rpkURI = prtu::toFileURI(rpk);
+		ResolveMapCacheEntry& rmce = mCache[contentHash];
+		rmce.mResolveMap = resolveMapPromise.get_future().share();
+		if (!mRPKUnpackPath.empty())
+			rmce.mUnpackPath = mRPKUnpackPath + prtu::getDirSeparator<std::wstring>() + toHexString(contentHash);
+		rmce.mRefCount = 1;
+		rmce.mLastAccess = ++mAccessCounter;
+		unpackPath = rmce.mUnpackPath;
+		mMisses++;
+	}
+	notifyEvicted(replaced);
 
-		ResolveMapCacheEntry rmce;
-		rmce.mTimeStamp = timeStamp;
+	// unpack without holding the lock, lookups of other RPKs are not blocked
+	const auto rpkURI = prtu::toFileURI(rpk);
 
+	ResolveMapSPtr newResolveMap;
+	bool persistent = false;
+	if (!mPersistentUnpackPath.empty()) {
+		const std::wstring persistentPath =
+		        mPersistentUnpackPath + prtu::getDirSeparator<std::wstring>() + toHexString(contentHash);
+		newResolveMap = getPersistentResolveMap(rpkURI, persistentPath);
+		if (newResolveMap) {
+			persistent = true;
+			unpackPath = persistentPath;
+		}
+	}
+
+	if (!newResolveMap) {
 		prt::Status status = prt::STATUS_UNSPECIFIED_ERROR;
 		if (DBG)
 			LOG_DBG << "createResolveMap from " << rpk;
-		rmce.mResolveMap.reset(prt::createResolveMap(rpkURI.c_str(), mRPKUnpackPath.c_str(), &status), PRTDestroyer());
+		newResolveMap.reset(prt::createResolveMap(rpkURI.c_str(), unpackPath.c_str(), &status), PRTDestroyer());
 		if (status != prt::STATUS_OK)
-			return LOOKUP_FAILURE;
+			newResolveMap.reset();
+	}
+	resolveMapPromise.set_value(newResolveMap);
+
+	if (!newResolveMap) {
+		// do not cache the failure, e.g. the RPK might still be in the process of being written
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		for (auto it = mRPKPaths.begin(); it != mRPKPaths.end();) {
+			if (it->second.mContentHash == contentHash)
+				it = mRPKPaths.erase(it);
+			else
+				++it;
+		}
+		mCache.erase(contentHash);
+		return LOOKUP_FAILURE;
+	}
+
+	if (DBG)
+		LOG_DBG << "Upacked RPK " << rpk << " to " << unpackPath;
+
+	// the persistent unpack path is not owned by us, it does not count towards our limits
+	const uint64_t unpackedBytes = (unpackPath.empty() || persistent) ? 0 : prtu::getDirectorySize(unpackPath);
+	EvictedResolveMaps evicted;
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mCache.find(contentHash);
+		if (it != mCache.end()) {
+			it->second.mUnpackPath = unpackPath;
+			it->second.mPersistent = persistent;
+			it->second.mUnpackedBytes = unpackedBytes;
+			mUnpackedBytes += unpackedBytes;
+		}
+		evictLeastRecentlyUsed(evicted);
+	}
+	notifyEvicted(evicted);
+
+	return {newResolveMap, CacheStatus::MISS};
+}
+
+ResolveMapCache::RulePackageInfoSPtr ResolveMapCache::getRulePackageInfo(const std::wstring& rpk, prt::Cache* cache) {
+	const ResolveMapSPtr resolveMap = get(rpk).first;
+	if (!resolveMap)
+		return {};
+
+	// the entry might have been evicted or replaced by a newer version of the RPK meanwhile
+	const auto isEntryOf = [&resolveMap](const ResolveMapCacheEntry& entry) {
+		return entry.mResolveMap.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+		       entry.mResolveMap.get() == resolveMap;
+	};
+
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mRPKPaths.find(rpk);
+		if (it != mRPKPaths.end()) {
+			const ResolveMapCacheEntry& entry = mCache.at(it->second.mContentHash);
+			if (isEntryOf(entry) && entry.mRulePackageInfo.valid()) {
+				const std::shared_future<RulePackageInfoSPtr> info = entry.mRulePackageInfo;
+				lock.unlock();
+				return info.get();
+			}
+		}
+	}
+
+	std::promise<RulePackageInfoSPtr> infoPromise;
+	std::shared_future<RulePackageInfoSPtr> info;
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		auto it = mRPKPaths.find(rpk);
+		if (it == mRPKPaths.end() || !isEntryOf(mCache.at(it->second.mContentHash))) {
+			lock.unlock();
+			return createRulePackageInfo(resolveMap, cache);
+		}
+
+		// another thread might be creating it already
+		ResolveMapCacheEntry& entry = mCache.at(it->second.mContentHash);
+		if (entry.mRulePackageInfo.valid()) {
+			info = entry.mRulePackageInfo;
+			lock.unlock();
+			return info.get();
+		}
+		info = infoPromise.get_future().share();
+		entry.mRulePackageInfo = info;
+	}
+
+	infoPromise.set_value(createRulePackageInfo(resolveMap, cache));
+	return info.get();
+}
+
+void ResolveMapCache::releaseEntry(uint64_t contentHash, EvictedResolveMaps& evicted) {
+	auto it = mCache.find(contentHash);
+	if (it == mCache.end() || --it->second.mRefCount > 0)
+		return;
+	removeEntry(it, evicted);
+}
+
+void ResolveMapCache::removeEntry(Cache::iterator it, EvictedResolveMaps& evicted) {
+	const std::shared_future<ResolveMapSPtr>& resolveMap = it->second.mResolveMap;
+	const bool isUnpacked =
+	        resolveMap.valid() && resolveMap.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	if (isUnpacked && resolveMap.get())
+		evicted.push_back(resolveMap.get());
+
+	// the resolve map itself stays alive as long as it is referenced by its users. The directory of an RPK which is
+	// still being unpacked is left to the destructor, which removes the whole unpack path.
+	if (isUnpacked && !it->second.mUnpackPath.empty() && !it->second.mPersistent)
+		removeUnpackDirectory(it->second.mUnpackPath);
+	mUnpackedBytes -= it->second.mUnpackedBytes;
+	mCache.erase(it);
+}
+
+void ResolveMapCache::removeUnpackDirectory(const std::wstring& path) {
+	// forget about finished removals
+	const auto isDone = [](const std::future<void>& f) {
+		return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	};
+	mPendingRemovals.erase(std::remove_if(mPendingRemovals.begin(), mPendingRemovals.end(), isDone),
+	                       mPendingRemovals.end());
+
+	// move the directory out of the way first, the same RPK content might get unpacked to the same path right away
+	const std::wstring removedPath = path + L".removed" + std::to_wstring(mRemovedDirectoryCount++);
+	if (prtu::renameFile(path, removedPath))
+		mPendingRemovals.emplace_back(std::async(std::launch::async, removeDirectory, removedPath));
+	else
+		removeDirectory(path);
+}
+
+void ResolveMapCache::evictLeastRecentlyUsed(EvictedResolveMaps& evicted) {
+	const auto exceedsLimits = [this]() {
+		return (mMaxEntries > 0 && mCache.size() > mMaxEntries) ||
+		       (mMaxUnpackedBytes > 0 && mUnpackedBytes > mMaxUnpackedBytes);
+	};
+
+	while (exceedsLimits()) {
+		// only consider RPKs which are unpacked and not in use anymore, i.e. the cache holds the last reference
+		auto lru = mCache.end();
+		for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+			const std::shared_future<ResolveMapSPtr>& resolveMap = it->second.mResolveMap;
+			if (resolveMap.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+			    resolveMap.get().use_count() > 1)
+				continue;
+			if (lru == mCache.end() || it->second.mLastAccess < lru->second.mLastAccess)
+				lru = it;
+		}
+		if (lru == mCache.end())
+			break;
 
-		it = mCache.emplace(rpk, std::move(rmce)).first;
 		if (DBG)
-			LOG_DBG << "Upacked RPK " << rpk << " to " << mRPKUnpackPath;
+			LOG_DBG << "evicting least recently used RPK " << lru->second.mUnpackPath;
+		for (auto it = mRPKPaths.begin(); it != mRPKPaths.end();) {
+			if (it->second.mContentHash == lru->first)
+				it = mRPKPaths.erase(it);
+			else
+				++it;
+		}
+		removeEntry(lru, evicted);
+		mEvictions++;
 	}
+}
+
+void ResolveMapCache::notifyEvicted(const EvictedResolveMaps& evicted) {
+	if (evicted.empty())
+		return;
+
+	EvictionCallback callback;
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mCacheMutex);
+		callback = mEvictionCallback;
+	}
+	if (!callback)
+		return;
+	for (const ResolveMapSPtr& resolveMap : evicted)
+		callback(*resolveMap);
+}
 
-	return {it->second.mResolveMap, cs};
+const std::shared_future<ResolveMapSPtr>& ResolveMapCache::access(ResolveMapCacheEntry& entry) {
+	entry.mLastAccess = ++mAccessCounter;
+	mHits++;
+	return entry.mResolveMap;
 }
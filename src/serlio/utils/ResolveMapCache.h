@@ -19,16 +19,26 @@
 
 #pragma once
 
+#include "modifiers/RuleAttributes.h"
 #include "utils/Utilities.h"
 
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <future>
 #include <map>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 class ResolveMapCache {
 public:
 	using KeyType = std::wstring;
 
-	explicit ResolveMapCache(const std::wstring& unpackPath) : mRPKUnpackPath{unpackPath} {}
+	// RPKs are unpacked into unpackPath (which is removed again with the cache), unless a persistent unpack path is
+	// given: RPKs unpacked there are kept and reused across processes and sessions
+	explicit ResolveMapCache(const std::wstring& unpackPath, const std::wstring& persistentUnpackPath = {})
+	    : mRPKUnpackPath{unpackPath}, mPersistentUnpackPath{persistentUnpackPath} {}
 	ResolveMapCache(const ResolveMapCache&) = delete;
 	ResolveMapCache(ResolveMapCache&&) = delete;
 	ResolveMapCache& operator=(ResolveMapCache const&) = delete;
@@ -39,15 +49,108 @@ public:
 	using LookupResult = std::pair<ResolveMapSPtr, CacheStatus>;
 	LookupResult get(const std::wstring& rpk);
 
+	// rule file data derived from the resolve map, immutable and shared by all users of the RPK
+	struct RulePackageInfo {
+		RuleFileInfoUPtr ruleFileInfo;
+		std::wstring ruleFile;
+		std::wstring startRule;
+		RuleAttributes ruleAttributes; // sorted, see sortRuleAttributes()
+		std::unordered_map<std::wstring, size_t> mayaFullNameIndex; // mayaFullName -> index into ruleAttributes
+
+		// nullptr if no rule attribute corresponds to the maya attribute
+		const RuleAttribute* findByMayaFullName(const std::wstring& mayaFullName) const {
+			const auto it = mayaFullNameIndex.find(mayaFullName);
+			return (it != mayaFullNameIndex.end()) ? &ruleAttributes[it->second] : nullptr;
+		}
+	};
+	using RulePackageInfoSPtr = std::shared_ptr<const RulePackageInfo>;
+	// created on first request, cache is used to create the rule file info. Empty if the RPK has no valid rule file.
+	RulePackageInfoSPtr getRulePackageInfo(const std::wstring& rpk, prt::Cache* cache);
+
+	// time during which a cached RPK is assumed to be unchanged, i.e. get() does not check its modification time
+	// (zero checks on every lookup)
+	static constexpr std::chrono::milliseconds DEFAULT_REVALIDATION_INTERVAL{1000};
+	void setRevalidationInterval(std::chrono::milliseconds interval);
+
+	// modification time of the RPK as of its last validation (i.e. without touching the file system if cached)
+	time_t getTimeStamp(const std::wstring& rpk);
+
+	// least recently used RPKs are evicted (and their unpack directories removed) if the cache grows beyond these
+	// limits, RPKs which are still in use (i.e. whose resolve map is referenced outside of the cache, e.g. by a node)
+	// are kept though (zero means no limit)
+	static constexpr size_t DEFAULT_MAX_ENTRIES = 64;
+	static constexpr uint64_t DEFAULT_MAX_UNPACKED_BYTES = 4ull << 30;
+	void setLimits(size_t maxEntries, uint64_t maxUnpackedBytes);
+
+	struct Stats {
+		size_t entries = 0;
+		uint64_t unpackedBytes = 0;
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+	};
+	Stats getStats();
+
+	// called with the resolve map of RPKs which are evicted or replaced by a modified version, e.g. to flush data
+	// derived from their files in other caches. Called after the cache has been unlocked, i.e. it may call back into
+	// the cache.
+	using EvictionCallback = std::function<void(const prt::ResolveMap&)>;
+	void setEvictionCallback(EvictionCallback callback);
+
 private:
+	// RPKs with identical content share one entry (and its unpack directory), even if they have different paths
 	struct ResolveMapCacheEntry {
-		ResolveMapSPtr mResolveMap;
-		time_t mTimeStamp;
+		// the resolve map becomes available once the RPK is unpacked, concurrent lookups of the same RPK wait for it
+		std::shared_future<ResolveMapSPtr> mResolveMap;
+		std::wstring mUnpackPath;
+		bool mPersistent = false; // i.e. mUnpackPath is shared with other processes and must not be removed
+		uint64_t mUnpackedBytes = 0;
+		size_t mRefCount = 0;                 // number of RPK paths with this content
+		std::atomic<uint64_t> mLastAccess{0}; // see mAccessCounter, updated by concurrent lookups
+		std::shared_future<RulePackageInfoSPtr> mRulePackageInfo; // invalid until requested
 	};
-	using Cache = std::map<KeyType, ResolveMapCacheEntry>;
+	using Cache = std::map<uint64_t, ResolveMapCacheEntry>;
 	Cache mCache;
 
+	struct RPKPathEntry {
+		uint64_t mContentHash;
+		time_t mTimeStamp;
+		std::chrono::steady_clock::time_point mLastValidation;
+	};
+	std::map<KeyType, RPKPathEntry> mRPKPaths;
+
+	// lookups share the lock, it is only held exclusively to modify the maps (but not while hashing or unpacking)
+	std::shared_timed_mutex mCacheMutex;
+
+	// resolve maps of removed entries, they are passed to the eviction callback once the lock is released
+	using EvictedResolveMaps = std::vector<ResolveMapSPtr>;
+
+	// drops a reference to a cache entry, removes the entry and its unpack directory with the last one
+	void releaseEntry(uint64_t contentHash, EvictedResolveMaps& evicted);
+	void removeEntry(Cache::iterator it, EvictedResolveMaps& evicted);
+	// removes the directory on a worker thread, the destructor waits for pending removals
+	void removeUnpackDirectory(const std::wstring& path);
+	void evictLeastRecentlyUsed(EvictedResolveMaps& evicted);
+	// calls the eviction callback, must not be called while holding the lock
+	void notifyEvicted(const EvictedResolveMaps& evicted);
+	const std::shared_future<ResolveMapSPtr>& access(ResolveMapCacheEntry& entry);
+
+	std::atomic<uint64_t> mAccessCounter{0};
+	size_t mMaxEntries = DEFAULT_MAX_ENTRIES;
+	uint64_t mMaxUnpackedBytes = DEFAULT_MAX_UNPACKED_BYTES;
+	uint64_t mUnpackedBytes = 0;
+	std::atomic<size_t> mHits{0};
+	std::atomic<size_t> mMisses{0};
+	size_t mEvictions = 0;
+	EvictionCallback mEvictionCallback;
+
+	std::vector<std::future<void>> mPendingRemovals;
+	size_t mRemovedDirectoryCount = 0;
+
+	std::chrono::milliseconds mRevalidationInterval = DEFAULT_REVALIDATION_INTERVAL;
+
 	const std::wstring mRPKUnpackPath;
+	const std::wstring mPersistentUnpackPath;
 };
 
-using ResolveMapCacheUPtr = std::unique_ptr<ResolveMapCache>;
\ No newline at end of file
+using ResolveMapCacheUPtr = std::unique_ptr<ResolveMapCache>;
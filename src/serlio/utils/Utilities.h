@@ -75,6 +75,7 @@ using RuleFileInfoUPtr = std::unique_ptr<const prt::RuleFileInfo, PRTDestroyer>;
 using EncoderInfoUPtr = std::unique_ptr<const prt::EncoderInfo, PRTDestroyer>;
 using OcclusionSetUPtr = std::unique_ptr<prt::OcclusionSet, PRTDestroyer>;
 using ResolveMapSPtr = std::shared_ptr<const prt::ResolveMap>;
+using AttributeMapSPtr = std::shared_ptr<const prt::AttributeMap>;
 
 namespace prtu {
 
@@ -100,6 +101,21 @@ time_t getFileModificationTime(const std::wstring& p);
 std::wstring temp_directory_path();
 std::wstring getProcessTempDir(const std::wstring& prefix);
 void remove_all(const std::wstring& path);
+// total size of the files in a directory tree (in bytes)
+uint64_t getDirectorySize(const std::wstring& path);
+// creates an empty file, fails if it already exists (atomic, also between processes)
+bool createFileExclusively(const std::wstring& path);
+// replaces an existing destination file
+bool renameFile(const std::wstring& from, const std::wstring& to);
+void removeFile(const std::wstring& path);
+// creates a single directory, the parent directory must exist
+bool createDirectory(const std::wstring& path);
+uint64_t getProcessId();
+// checks for a process of this host, false if there is no such process (anymore)
+bool isProcessRunning(uint64_t pid);
+std::wstring getHostName();
+// resident memory (working set) of this process in bytes, zero if unknown
+uint64_t getProcessResidentMemory();
 std::wstring toGenericPath(const std::wstring& osPath);
 
 template <typename C>
@@ -109,6 +125,29 @@ char getDirSeparator();
 template <>
 wchar_t getDirSeparator();
 
+// fast non-cryptographic 64bit hash, suitable for cache keys (not stable across serlio versions)
+SRL_TEST_EXPORTS_API uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+
+template <typename T>
+uint64_t hash(const std::vector<T>& v, uint64_t seed = 0) {
+	return hash(v.data(), v.size() * sizeof(T), seed);
+}
+
+// hash of the file content, returns false if the file cannot be read
+SRL_TEST_EXPORTS_API bool getFileContentHash(const std::wstring& p, uint64_t& contentHash);
+
+// converts count floats to doubles in a single (vectorized) pass, dst must provide room for count values
+SRL_TEST_EXPORTS_API void widen(const float* src, double* dst, size_t count);
+// converts count doubles to floats, dst must provide room for count values
+SRL_TEST_EXPORTS_API void narrow(const double* src, float* dst, size_t count);
+// converts packed xyz double coordinates to homogeneous xyzw float points (w = 1, the layout of maya float points)
+SRL_TEST_EXPORTS_API void narrowToPoints(const double* src, float* dst, size_t numPoints);
+// converts interleaved uv double coordinates to separate u and v float arrays
+SRL_TEST_EXPORTS_API void narrowAndSplitUVs(const double* src, float* dstU, float* dstV, size_t numUVs);
+// float variants of the above for encoder output which already is in single precision
+SRL_TEST_EXPORTS_API void toPoints(const float* src, float* dst, size_t numPoints);
+SRL_TEST_EXPORTS_API void splitUVs(const float* src, float* dstU, float* dstV, size_t numUVs);
+
 int fromHex(wchar_t c);
 wchar_t toHex(int i);
 
@@ -141,9 +180,17 @@ template <typename T>
 std::string objectToXML(std::unique_ptr<T, PRTDestroyer>& ptr) {
 	return objectToXML(ptr.get());
 }
+template <typename T>
+std::string objectToXML(const std::shared_ptr<T>& ptr) {
+	return objectToXML(ptr.get());
+}
 
 AttributeMapUPtr createValidatedOptions(const wchar_t* encID, const prt::AttributeMap* unvalidatedOptions = nullptr);
 
+// sets the bool, float and string values which differ from (or are missing in) the default values into dst
+SRL_TEST_EXPORTS_API void setChangedAttributes(prt::AttributeMapBuilder& dst, const prt::AttributeMap& values,
+                                               const prt::AttributeMap& defaultValues);
+
 inline std::wstring getRuleFileEntry(ResolveMapSPtr resolveMap) {
 	const std::wstring sCGB(L".cgb");
 
@@ -21,12 +21,19 @@
 
 #include "modifiers/RuleAttributes.h"
 
+#include "utils/DefaultAttributeValuesCache.h"
 #include "utils/LogHandler.h"
 #include "utils/Utilities.h"
 
 #define CATCH_CONFIG_RUNNER
 #include "catch/catch.hpp"
 
+#include <cstdio>
+#include <cwchar>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <numeric>
 #include <sstream>
 
 namespace {
@@ -137,6 +144,142 @@ TEST_CASE("default attribute values") {
 	// TODO: add assertion for value, needs interface into PRTModifierAction.cpp without introducing maya dep here
 }
 
+TEST_CASE("rule package info is shared") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+
+	const auto info = prtCtx->mResolveMapCache->getRulePackageInfo(rpk, prtCtx->theCache.get());
+	REQUIRE(info);
+	CHECK(info->ruleFile == L"bin/r1.cgb");
+	CHECK(info->ruleFileInfo);
+	CHECK(info == prtCtx->mResolveMapCache->getRulePackageInfo(rpk, prtCtx->theCache.get()));
+
+	for (const RuleAttribute& ra : info->ruleAttributes)
+		CHECK(info->findByMayaFullName(ra.mayaFullName) == &ra);
+	CHECK(info->findByMayaFullName(L"noSuchAttribute") == nullptr);
+}
+
+TEST_CASE("concurrent resolve map lookups") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+
+	std::vector<std::future<ResolveMapCache::LookupResult>> lookups;
+	for (size_t i = 0; i < 8; i++)
+		lookups.emplace_back(std::async(std::launch::async, [&rpk]() { return prtCtx->mResolveMapCache->get(rpk); }));
+
+	// all lookups share the resolve map of a single unpack
+	ResolveMapSPtr resolveMap = lookups.front().get().first;
+	REQUIRE(resolveMap);
+	for (size_t i = 1; i < lookups.size(); i++)
+		CHECK(lookups[i].get().first == resolveMap);
+}
+
+TEST_CASE("identical resolve maps are shared") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring rpkCopy = prtu::temp_directory_path() + prtu::getDirSeparator<std::wstring>() +
+	                             L"serlio_test_copy_of_CE-6813.rpk";
+	{
+		std::ifstream src(prtu::toOSNarrowFromUTF16(rpk), std::ios::binary);
+		std::ofstream dst(prtu::toOSNarrowFromUTF16(rpkCopy), std::ios::binary);
+		dst << src.rdbuf();
+	}
+
+	uint64_t rpkHash = 0;
+	uint64_t rpkCopyHash = 1;
+	REQUIRE(prtu::getFileContentHash(rpk, rpkHash));
+	REQUIRE(prtu::getFileContentHash(rpkCopy, rpkCopyHash));
+	CHECK(rpkHash == rpkCopyHash);
+
+	const ResolveMapSPtr resolveMap = prtCtx->mResolveMapCache->get(rpk).first;
+	const ResolveMapSPtr resolveMapOfCopy = prtCtx->mResolveMapCache->get(rpkCopy).first;
+	REQUIRE(resolveMap);
+	CHECK(resolveMap == resolveMapOfCopy);
+
+	std::remove(prtu::toOSNarrowFromUTF16(rpkCopy).c_str());
+}
+
+TEST_CASE("resolve map cache eviction") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	ResolveMapCache cache(prtu::getProcessTempDir(L"serlio_test_eviction_"));
+	size_t evictedResolveMaps = 0;
+	cache.setEvictionCallback([&cache, &evictedResolveMaps](const prt::ResolveMap& resolveMap) {
+		CHECK(resolveMap.getString(L"bin/r1.cgb") != nullptr);
+		CHECK(cache.getStats().entries == 0); // called after unlocking, i.e. the entry is already gone
+		evictedResolveMaps++;
+	});
+
+	{
+		const ResolveMapSPtr resolveMap = cache.get(rpk).first;
+		REQUIRE(resolveMap);
+		CHECK(cache.get(rpk).second == ResolveMapCache::CacheStatus::HIT);
+
+		// in use, must not be evicted
+		cache.setLimits(1, 1);
+		CHECK(cache.getStats().entries == 1);
+		CHECK(cache.getStats().unpackedBytes > 0);
+	}
+
+	cache.setLimits(1, 1);
+	const ResolveMapCache::Stats stats = cache.getStats();
+	CHECK(stats.entries == 0);
+	CHECK(stats.unpackedBytes == 0);
+	CHECK(stats.hits == 1);
+	CHECK(stats.misses == 1);
+	CHECK(stats.evictions == 1);
+	CHECK(evictedResolveMaps == 1);
+
+	CHECK(cache.get(rpk).second == ResolveMapCache::CacheStatus::MISS);
+}
+
+TEST_CASE("persistent resolve map cache") {
+	const std::wstring rpk = testDataPath + L"/CE-6813-wrong-attr-style.rpk";
+	const std::wstring persistentPath = prtu::getProcessTempDir(L"serlio_test_persistent_store_");
+	prtu::createDirectory(persistentPath);
+	REQUIRE(prtu::getFileModificationTime(persistentPath) != -1);
+
+	uint64_t contentHash = 0;
+	REQUIRE(prtu::getFileContentHash(rpk, contentHash));
+	std::wostringstream unpackPath;
+	unpackPath << persistentPath << prtu::getDirSeparator<wchar_t>() << std::hex << std::setw(16)
+	           << std::setfill(L'0') << contentHash;
+	const std::wstring indexPath = unpackPath.str() + L".index";
+	const std::wstring lockPath = unpackPath.str() + L".lock";
+
+	SECTION("reuse") {
+		// unpacking the RPK again would remove the marker file
+		const std::wstring markerPath = unpackPath.str() + prtu::getDirSeparator<wchar_t>() + L"marker";
+
+		// first session unpacks the RPK, the second one just reads the index
+		for (int session = 0; session < 2; session++) {
+			ResolveMapCache cache(prtu::getProcessTempDir(L"serlio_test_persistent_"), persistentPath);
+			const ResolveMapSPtr resolveMap = cache.get(rpk).first;
+			REQUIRE(resolveMap);
+			CHECK(resolveMap->getString(L"bin/r1.cgb") != nullptr);
+			REQUIRE(prtu::getFileModificationTime(indexPath) != -1);
+			if (session == 0)
+				REQUIRE(prtu::createFileExclusively(markerPath));
+			else
+				CHECK(prtu::getFileModificationTime(markerPath) != -1);
+		}
+	}
+
+	SECTION("stale lock") {
+		// lock of a process of this host which is not running (the pid is neither a valid linux nor windows pid)
+		{
+			std::ofstream lock(prtu::toOSNarrowFromUTF16(lockPath));
+			lock << "2147483647@" << prtu::toUTF8FromUTF16(prtu::getHostName());
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		ResolveMapCache cache(prtu::getProcessTempDir(L"serlio_test_persistent_"), persistentPath);
+		const ResolveMapSPtr resolveMap = cache.get(rpk).first;
+		REQUIRE(resolveMap);
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+		CHECK(prtu::getFileModificationTime(indexPath) != -1);
+		CHECK(prtu::getFileModificationTime(lockPath) == -1);
+	}
+
+	prtu::remove_all(persistentPath);
+}
+
 const AttributeGroup AG_NONE = {};
 const AttributeGroup AG_A = {L"a"};
 const AttributeGroup AG_AK = {L"a", L"k"};
@@ -297,6 +440,217 @@ TEST_CASE("toFileURI") {
 #endif
 }
 
+TEST_CASE("file content hash") {
+	uint64_t h = 0;
+	CHECK_FALSE(prtu::getFileContentHash(testDataPath + L"/does-not-exist.rpk", h));
+}
+
+TEST_CASE("hash") {
+	const std::vector<double> a = {1.0, 2.0, 3.0};
+	const std::vector<double> b = {1.0, 2.0, 3.5};
+	CHECK(prtu::hash(a) == prtu::hash(a));
+	CHECK(prtu::hash(a) != prtu::hash(b));
+	CHECK(prtu::hash(a) != prtu::hash(a, 1));
+	CHECK(prtu::hash(std::vector<double>()) != prtu::hash(a));
+}
+
+TEST_CASE("widen") {
+	std::vector<float> src(11);
+	std::iota(src.begin(), src.end(), -5.5f);
+
+	SECTION("full") {
+		std::vector<double> dst(src.size());
+		prtu::widen(src.data(), dst.data(), src.size());
+		for (size_t i = 0; i < src.size(); i++)
+			CHECK(dst[i] == static_cast<double>(src[i]));
+	}
+
+	SECTION("partial") {
+		std::vector<double> dst(src.size(), 42.0);
+		prtu::widen(src.data(), dst.data(), 6);
+		CHECK(dst[5] == static_cast<double>(src[5]));
+		CHECK(dst[6] == 42.0);
+	}
+}
+
+TEST_CASE("narrow") {
+	std::vector<double> src(15);
+	std::iota(src.begin(), src.end(), -7.25);
+
+	SECTION("plain") {
+		std::vector<float> dst(src.size());
+		prtu::narrow(src.data(), dst.data(), src.size());
+		for (size_t i = 0; i < src.size(); i++)
+			CHECK(dst[i] == static_cast<float>(src[i]));
+	}
+
+	SECTION("points") {
+		const size_t numPoints = src.size() / 3;
+		std::vector<float> dst(4 * numPoints);
+		prtu::narrowToPoints(src.data(), dst.data(), numPoints);
+		for (size_t p = 0; p < numPoints; p++) {
+			CHECK(dst[4 * p + 0] == static_cast<float>(src[3 * p + 0]));
+			CHECK(dst[4 * p + 1] == static_cast<float>(src[3 * p + 1]));
+			CHECK(dst[4 * p + 2] == static_cast<float>(src[3 * p + 2]));
+			CHECK(dst[4 * p + 3] == 1.0f);
+		}
+	}
+
+	SECTION("uvs") {
+		const size_t numUVs = src.size() / 2;
+		std::vector<float> u(numUVs);
+		std::vector<float> v(numUVs);
+		prtu::narrowAndSplitUVs(src.data(), u.data(), v.data(), numUVs);
+		for (size_t i = 0; i < numUVs; i++) {
+			CHECK(u[i] == static_cast<float>(src[2 * i + 0]));
+			CHECK(v[i] == static_cast<float>(src[2 * i + 1]));
+		}
+	}
+}
+
+TEST_CASE("float points and uvs") {
+	std::vector<float> src(15);
+	std::iota(src.begin(), src.end(), -7.25f);
+
+	SECTION("points") {
+		const size_t numPoints = src.size() / 3;
+		std::vector<float> dst(4 * numPoints);
+		prtu::toPoints(src.data(), dst.data(), numPoints);
+		for (size_t p = 0; p < numPoints; p++) {
+			CHECK(dst[4 * p + 0] == src[3 * p + 0]);
+			CHECK(dst[4 * p + 1] == src[3 * p + 1]);
+			CHECK(dst[4 * p + 2] == src[3 * p + 2]);
+			CHECK(dst[4 * p + 3] == 1.0f);
+		}
+	}
+
+	SECTION("uvs") {
+		const size_t numUVs = src.size() / 2;
+		std::vector<float> u(numUVs);
+		std::vector<float> v(numUVs);
+		prtu::splitUVs(src.data(), u.data(), v.data(), numUVs);
+		for (size_t i = 0; i < numUVs; i++) {
+			CHECK(u[i] == src[2 * i + 0]);
+			CHECK(v[i] == src[2 * i + 1]);
+		}
+	}
+}
+
+TEST_CASE("default attribute values cache") {
+	DefaultAttributeValuesCache cache;
+
+	size_t evalCount = 0;
+	const auto evaluate = [&evalCount]() {
+		evalCount++;
+		AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+		amb->setFloat(L"Default$height", 10.0);
+		return AttributeMapUPtr(amb->createAttributeMap());
+	};
+
+	const DefaultAttributeValuesCache::Key key{L"/tmp/foo.rpk", 1, L"bin/foo.cgb", L"Default$Lot", 42, 1234};
+
+	SECTION("hit") {
+		const AttributeMapSPtr a = cache.get(key, evaluate);
+		const AttributeMapSPtr b = cache.get(key, evaluate);
+		CHECK(a == b);
+		CHECK(a->getFloat(L"Default$height") == 10.0);
+		CHECK(evalCount == 1);
+		CHECK(cache.getHitCount() == 1);
+		CHECK(cache.getMissCount() == 1);
+	}
+
+	SECTION("different geometry") {
+		DefaultAttributeValuesCache::Key otherKey = key;
+		otherKey.geometryHash++;
+		cache.get(key, evaluate);
+		cache.get(otherKey, evaluate);
+		CHECK(evalCount == 2);
+		CHECK(cache.size() == 2);
+	}
+
+	SECTION("modified rule package") {
+		DefaultAttributeValuesCache::Key modifiedKey = key;
+		modifiedKey.rpkTimeStamp++;
+		cache.get(key, evaluate);
+		cache.get(modifiedKey, evaluate);
+		CHECK(evalCount == 2);
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("least recently used") {
+		std::vector<DefaultAttributeValuesCache::Key> keys(DefaultAttributeValuesCache::MAX_ENTRIES, key);
+		for (size_t i = 0; i < keys.size(); i++) {
+			keys[i].geometryHash = i;
+			cache.get(keys[i], evaluate);
+		}
+		cache.get(keys[0], evaluate); // the second entry is now the least recently used one
+
+		DefaultAttributeValuesCache::Key newKey = key;
+		newKey.geometryHash = keys.size();
+		cache.get(newKey, evaluate);
+		CHECK(cache.size() == DefaultAttributeValuesCache::MAX_ENTRIES);
+
+		evalCount = 0;
+		cache.get(keys[0], evaluate);
+		CHECK(evalCount == 0);
+		cache.get(keys[1], evaluate);
+		CHECK(evalCount == 1);
+	}
+}
+
+TEST_CASE("changed attributes") {
+	AttributeMapBuilderUPtr amb(prt::AttributeMapBuilder::create());
+	amb->setFloat(L"Default$height", 10.0);
+	amb->setBool(L"Default$roof", true);
+	amb->setString(L"Default$color", L"#ff0000");
+	const AttributeMapSPtr defaultValues(amb->createAttributeMapAndReset(), PRTDestroyer());
+
+	// node values with an edited height and an attribute which is not a rule attribute (anymore)
+	amb->setFloat(L"Default$height", 12.0);
+	amb->setBool(L"Default$roof", true);
+	amb->setString(L"Default$color", L"#ff0000");
+	amb->setString(L"Default$material", L"brick");
+	const AttributeMapUPtr nodeValues(amb->createAttributeMapAndReset());
+
+	const auto getChangedAttributes = [&nodeValues](const AttributeMapSPtr& defaults) {
+		AttributeMapBuilderUPtr changed(prt::AttributeMapBuilder::create());
+		prtu::setChangedAttributes(*changed, *nodeValues, *defaults);
+		return AttributeMapUPtr(changed->createAttributeMap());
+	};
+
+	SECTION("only changed values") {
+		const AttributeMapUPtr changed = getChangedAttributes(defaultValues);
+		size_t keyCount = 0;
+		changed->getKeys(&keyCount);
+		CHECK(keyCount == 2);
+		CHECK(changed->getFloat(L"Default$height") == 12.0);
+		CHECK(std::wcscmp(changed->getString(L"Default$material"), L"brick") == 0);
+	}
+
+	SECTION("single and multi pass") {
+		// multi pass evaluates the default values on a cache miss, single pass stores the values evaluated by its
+		// generate call, both compare the node values against the cache entry
+		const DefaultAttributeValuesCache::Key key{L"/tmp/foo.rpk", 1, L"bin/foo.cgb", L"Default$Lot", 42, 1234};
+		const auto evaluate = [&defaultValues]() {
+			AttributeMapBuilderUPtr evaluated(prt::AttributeMapBuilder::createFromAttributeMap(defaultValues.get()));
+			return AttributeMapUPtr(evaluated->createAttributeMap());
+		};
+		const auto failEvaluate = []() {
+			FAIL("default values must be cached");
+			return AttributeMapUPtr();
+		};
+
+		DefaultAttributeValuesCache multiPassCache;
+		const AttributeMapUPtr multiPassChanged = getChangedAttributes(multiPassCache.get(key, evaluate));
+
+		DefaultAttributeValuesCache singlePassCache;
+		singlePassCache.put(key, defaultValues);
+		const AttributeMapUPtr singlePassChanged = getChangedAttributes(singlePassCache.get(key, failEvaluate));
+
+		CHECK(prtu::objectToXML(singlePassChanged) == prtu::objectToXML(multiPassChanged));
+	}
+}
+
 // we use a custom main function to manage PRT lifetime
 int main(int argc, char* argv[]) {
 	const std::vector<std::wstring> addExtDirs = {